@@ -53,3 +53,10 @@ char UART_InChar(void);
 // Input: letter is an 8-bit ASCII character to be transferred
 // Output: none
 void UART_OutChar(char data);
+
+//------------UART_Mute------------
+// Discard (or resume) characters written through fputc()
+// UART_OutChar() is not affected
+// Input: mute is nonzero to discard printf() output
+// Output: the previous setting, to restore it with
+int UART_Mute(int mute);
@@ -0,0 +1,32 @@
+#ifndef __COST_MODEL_H__
+#define __COST_MODEL_H__
+#include <stdint.h>
+#include "malloc.h"
+
+// Cortex-M4 cycle estimate from the work an instrumented allocator counts
+// (see HEAP_COUNT_ACCESSES). The counts don't depend on the clock, so the
+// model predicts cycles on the target from any build that produces them.
+//
+//     cycles = calls * call + loads * load + stores * store
+//              + branches * (branch + flash_wait * (100 - prefetch_hit) / 100)
+//
+// Branches are the data dependent loop iterations; everything a call does
+// a fixed number of times is folded into call.
+typedef struct _cost_model
+{
+    const char * name;
+    uint32_t call;          // cycles per call: entry, exit, straight line code
+    uint32_t load;          // per metadata load
+    uint32_t store;         // per metadata store
+    uint32_t branch;        // per taken branch, including the pipeline refill
+    uint32_t flash_wait;    // flash wait states at the core clock
+    uint32_t prefetch_hit;  // percent of branch targets already in the prefetch buffer
+} cost_model_t;
+
+// TM4C1294 at 120 MHz; adjustable with the cost command
+extern cost_model_t cost_model;
+
+// estimated cycles for all calls counted in stat
+uint64_t cost_estimate(const cost_model_t * model, const heap_stat * stat);
+
+#endif//__COST_MODEL_H__
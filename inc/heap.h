@@ -31,12 +31,31 @@
 #include "malloc.h"
 // feel free to change HEAP_SIZE_BYTES to however
 // big you want the heap to be
+// Heap_InitRegion can place a heap of any size elsewhere at run time
 #define HEAP_SIZE_BYTES (MALLOC_SIZE)
 #define HEAP_SIZE_WORDS (HEAP_SIZE_BYTES / sizeof(int32_t))
+// Heap_AddRegion can extend the heap into this many disjoint regions in all
+#define HEAP_MAX_REGIONS 4
 
 #define HEAP_OK 0
 #define HEAP_ERROR_CORRUPTED_HEAP 1
 #define HEAP_ERROR_POINTER_OUT_OF_RANGE 2
+#define HEAP_ERROR_BAD_REGION 3
+
+// one contiguous piece of a heap, sentinels included
+typedef struct heap_region {
+  int32_t* start;
+  int32_t* end;
+} heap_region_t;
+
+// all the state of one heap; the plain Heap_ functions work on a
+// built in heap, the _r versions on the one they are given.  Any
+// number of heaps can be in use at once as long as each one is only
+// used by one caller at a time.
+typedef struct heap {
+  heap_region_t regions[HEAP_MAX_REGIONS];
+  int32_t numRegions;
+} heap_t;
 
 // struct for holding statistics on the state of the heap
 typedef struct heap_stats {
@@ -45,26 +64,105 @@ typedef struct heap_stats {
   int32_t wordsOverhead;
   int32_t blocksUsed;
   int32_t blocksUnused;
+  int32_t wordsLargestFree;
 } heap_stats_t;
 
+// metadata accesses counted by a HEAP_COUNT_ACCESSES build
+typedef struct heap_access {
+  int32_t loads;
+  int32_t stores;
+  int32_t lines;    // distinct 32 byte lines
+  int32_t branches; // iterations of loops over blocks or words
+} heap_access_t;
+
+// called once per block by Heap_Walk, in address order
+// data points at the block's room, used is nonzero for allocated blocks
+typedef void (*heap_walker_t)(void* data, int32_t bytes, int32_t used, void* ctx);
+
 //******** Heap_Init *************** 
 // Initialize the Heap
 // input: none
 // output: always HEAP_OK
 // notes: Initializes/resets the heap to a clean state where no memory
-//  is allocated.
+//  is allocated.  Uses all of heap_mem.
 int32_t Heap_Init(void);
 
 
+//******** Heap_InitRegion *************** 
+// Initialize the Heap in the given memory
+// input:
+//   base: start of the memory for the heap
+//   bytes: size of that memory in bytes
+// output: HEAP_OK, or HEAP_ERROR_BAD_REGION if the memory can't hold
+//   even one block
+// notes: base is rounded up and the end rounded down to whole words.
+//  Initializes/resets the heap to a clean state where no memory
+//  is allocated.  Any regions added by Heap_AddRegion are dropped;
+//  this memory becomes region 0.
+int32_t Heap_InitRegion(void* base, int32_t bytes);
+
+
+//******** Heap_AddRegion *************** 
+// Add more memory to the Heap
+// input:
+//   base: start of the memory to add
+//   bytes: size of that memory in bytes
+// output: HEAP_OK, or HEAP_ERROR_BAD_REGION if the memory can't hold
+//   even one block, overlaps the heap or there are already
+//   HEAP_MAX_REGIONS regions
+// notes: the memory need not be next to the rest of the heap.  It
+//  becomes the next region number and starts out entirely unused.
+int32_t Heap_AddRegion(void* base, int32_t bytes);
+
+
 //******** Heap_Malloc *************** 
 // Allocate memory, data not initialized
 // input: 
 //   desiredBytes: desired number of bytes to allocate
 // output: void* pointing to the allocated memory or will return NULL
 //   if there isn't sufficient space to satisfy allocation request
+// notes: regions are searched in the order they were added
 void* Heap_Malloc(int32_t desiredBytes);
 
 
+//******** Heap_MallocRegion *************** 
+// Allocate memory, preferably in the given region
+// input: 
+//   desiredBytes: desired number of bytes to allocate
+//   region: region number to try first, 0 for the Heap_InitRegion memory
+// output: void* pointing to the allocated memory or will return NULL
+//   if there isn't sufficient space in any region
+// notes: the hint is only a preference; if the region is full the other
+//   regions are searched in order.  An unknown region number acts as 0.
+void* Heap_MallocRegion(int32_t desiredBytes, int32_t region);
+
+
+//******** Heap_MallocBatch *************** 
+// Allocate several blocks of the same size, data not initialized
+// input: 
+//   desiredBytes: desired number of bytes in each block
+//   count: number of blocks wanted
+//   blocks: receives the blocks
+// output: number of blocks allocated; they are the first entries of
+//   blocks and the rest are set to NULL
+// notes: same placement as count calls to Heap_Malloc, but the heap is
+//   scanned once; each block is carved off the front of the free block
+//   that held the previous one
+int32_t Heap_MallocBatch(int32_t desiredBytes, int32_t count, void** blocks);
+
+
+//******** Heap_Memalign *************** 
+// Allocate memory whose address is a multiple of alignment
+// input:
+//   alignment: power of 2 byte alignment for the returned pointer
+//   desiredBytes: desired number of bytes to allocate
+// output: void* pointing to the allocated memory or will return NULL
+//   if there isn't sufficient space or alignment isn't a power of 2
+// notes: the slack in front of the aligned block is split off as its
+//   own unused block, so it stays available to later allocations
+void* Heap_Memalign(int32_t alignment, int32_t desiredBytes);
+
+
 //******** Heap_Calloc *************** 
 // Allocate memory, data are initialized to 0
 // input:
@@ -84,7 +182,9 @@ void* Heap_Calloc(int32_t num, int32_t size);
 // output: void* pointing to the new block or will return NULL
 //   if there is any reason the reallocation can't be completed
 // notes: the given block will be unallocated after its contents
-//   are copied to the new block
+//   are copied to the new block; if the given block already has room
+//   for desiredBytes it is returned as is.  A moved block stays in the
+//   old block's region if that region has room.
 void* Heap_Realloc(void* oldBlock, int32_t desiredBytes);
 
 
@@ -98,6 +198,36 @@ void* Heap_Realloc(void* oldBlock, int32_t desiredBytes);
 int32_t Heap_Free(void* pointer);
 
 
+//******** Heap_FreeSized *************** 
+// return a block of known size to the heap
+// input:
+//   pointer: pointer to memory to unallocate
+//   bytes: number of bytes asked for when the block was allocated,
+//     or 0 if unknown
+// output: HEAP_OK if everything is ok;
+//  HEAP_ERROR_POINTER_OUT_OF_RANGE if pointer points outside the heap;
+//  HEAP_ERROR_CORRUPTED_HEAP if heap has been corrupted, trying to
+//  unallocate memory that has already been unallocated, or the block
+//  has less room than bytes
+// notes: the size check catches a wrong pointer or a smashed header
+//  before anything is written
+int32_t Heap_FreeSized(void* pointer, int32_t bytes);
+
+
+//******** Heap_FreeBatch *************** 
+// return several blocks to the heap
+// input:
+//   blocks: pointers to memory to unallocate, NULLs are skipped
+//   count: number of pointers
+// output: HEAP_OK if every block was freed, otherwise the error
+//  Heap_Free would give for the first bad pointer; bad pointers are
+//  skipped and set to NULL in blocks, and the rest are still freed
+// notes: blocks is sorted by address in place.  Runs of adjacent blocks
+//  are then merged with each other and their unused neighbours at once,
+//  writing one header and trailer per run instead of one per block.
+int32_t Heap_FreeBatch(void** blocks, int32_t count);
+
+
 //******** Heap_Test *************** 
 // Test the heap
 // input: none
@@ -109,7 +239,68 @@ int32_t Heap_Test(void);
 // return the current status of the heap
 // input: none
 // output: a heap_stats_t that describes the current usage of the heap
+// notes: sentinel blocks count as overhead, not as used blocks
 heap_stats_t Heap_Stats(void);
 
 
+//******** Heap_Walk *************** 
+// Visit every block of the heap
+// input:
+//   walker: function called with each block
+//   ctx: passed through to walker
+// output: HEAP_OK, or HEAP_ERROR_CORRUPTED_HEAP if the walk fell off the
+//   heap; blocks up to the corruption have been visited
+// notes: regions are walked in order; sentinel blocks are skipped
+int32_t Heap_Walk(heap_walker_t walker, void* ctx);
+
+
+//******** Heap_Size *************** 
+// Usable size of an allocated block
+// input: pointer returned by Heap_Malloc/Calloc/Realloc
+// output: number of bytes the block can hold, or 0 if the pointer
+//   isn't an allocated block in the heap
+int32_t Heap_Size(void* pointer);
+
+
+//******** Heap_X_r *************** 
+// Same as Heap_X, on the given heap
+// input: the heap, then the inputs of Heap_X
+// output: the output of Heap_X
+// notes: the heap must be set up by Heap_InitRegion_r before
+//  anything else is done with it
+int32_t Heap_InitRegion_r(heap_t* heap, void* base, int32_t bytes);
+int32_t Heap_AddRegion_r(heap_t* heap, void* base, int32_t bytes);
+void* Heap_Malloc_r(heap_t* heap, int32_t desiredBytes);
+void* Heap_MallocRegion_r(heap_t* heap, int32_t desiredBytes, int32_t region);
+int32_t Heap_MallocBatch_r(heap_t* heap, int32_t desiredBytes, int32_t count, void** blocks);
+void* Heap_Memalign_r(heap_t* heap, int32_t alignment, int32_t desiredBytes);
+void* Heap_Calloc_r(heap_t* heap, int32_t num, int32_t size);
+void* Heap_Realloc_r(heap_t* heap, void* oldBlock, int32_t desiredBytes);
+int32_t Heap_Free_r(heap_t* heap, void* pointer);
+int32_t Heap_FreeSized_r(heap_t* heap, void* pointer, int32_t bytes);
+int32_t Heap_FreeBatch_r(heap_t* heap, void** blocks, int32_t count);
+int32_t Heap_Test_r(heap_t* heap);
+heap_stats_t Heap_Stats_r(heap_t* heap);
+int32_t Heap_Walk_r(heap_t* heap, heap_walker_t walker, void* ctx);
+int32_t Heap_Size_r(heap_t* heap, void* pointer);
+
+
+// Add HEAP_COUNT_ACCESSES to the project defines for the instrumented
+// build.  Counting costs cycles itself, so time with a normal build.
+#ifdef HEAP_COUNT_ACCESSES
+//******** Heap_AccessReset *************** 
+// Start counting metadata accesses from zero
+// input: none
+// output: none
+void Heap_AccessReset(void);
+
+
+//******** Heap_Accesses *************** 
+// Metadata accesses since Heap_AccessReset
+// input: none
+// output: loads, stores, distinct lines touched and loop branches
+heap_access_t Heap_Accesses(void);
+#endif
+
+
 #endif //#ifndef HEAP_H
@@ -4,6 +4,12 @@
 #include <stdint.h>
 
 #define MALLOC_SIZE 0x10000
+// regions the heap can span, including the first
+#define MALLOC_MAX_REGIONS 4
+// allocator instances that can exist at once, including the default heap
+#define MALLOC_MAX_HEAPS 8
+// smallest first region of a heap; knuth_init can't check it itself
+#define MALLOC_MIN_REGION 64
 extern uint8_t heap_mem[MALLOC_SIZE];
 
 
@@ -15,12 +21,27 @@ typedef enum _heap_impl
 
 typedef struct _heap_stat
 {
-    uint32_t st; // success time
+    uint64_t st; // success time
     uint32_t sn; // success count
-    uint32_t ft; // fail time
+    uint64_t ft; // fail time
     uint32_t fn; // fail count
+    // metadata accesses over all calls, zero unless the allocator counts them
+    uint64_t loads;
+    uint64_t stores;
+    uint64_t lines;
+    uint64_t branches;
 } heap_stat;
 
+// metadata accesses of one call, from an allocator built to count them
+// (HEAP_COUNT_ACCESSES for Valvano); a clock independent cost measure
+typedef struct _heap_access
+{
+    uint32_t loads;
+    uint32_t stores;
+    uint32_t lines;     // distinct 32 byte lines touched
+    uint32_t branches;  // iterations of data dependent loops
+} heap_access;
+
 typedef struct _heap_stats
 {
 	// stats
@@ -28,16 +49,141 @@ typedef struct _heap_stats
     heap_stat calloc;
     heap_stat free;
     heap_stat realloc;
+    heap_stat memalign;
 } heap_stats;
 
+// block visitor for malloc_walk, called in address order
+// ptr is the start of the block's usable memory, used is nonzero if allocated
+typedef void (* heap_walker) (void * ptr, size_t size, int used, void * ctx);
+
+// totals for one call site of the allocator, see malloc_record
+#define MALLOC_CALLSITES_BITS 6
+#define MALLOC_CALLSITES (1 << MALLOC_CALLSITES_BITS)     // table slots
+typedef struct _callsite
+{
+    uintptr_t addr;     // return address of the call
+    char op;            // m(alloc), c(alloc), r(ealloc), a(ligned) or f(ree)
+    uint32_t count;
+    uint32_t bytes;     // requested, 0 for frees
+    uint64_t cycles;
+} callsite;
+
+// introspection results when the allocator can't answer
+#define MALLOC_UNSUPPORTED (-1)
+
+// (re)initializes impl in the current region, all of heap_mem by default
 void malloc_init(heap_impl impl);
+// moves the heap to [base, base + size) and initializes impl there
+// drops any regions added with malloc_add_region; 0 if ok, 1 if impl
+// can't use the memory, and then the heap is left as it was
+int malloc_init_region(heap_impl impl, void * base, size_t size);
+// extends the heap with the disjoint memory [base, base + size)
+// 0 if ok, MALLOC_UNSUPPORTED if the allocator manages a single region
+int malloc_add_region(void * base, size_t size);
+heap_impl malloc_current_impl(void);
+// bytes over all regions
+size_t malloc_heap_size(void);
+// start of the first region
+void * malloc_heap_base(void);
+int malloc_num_regions(void);
+void * malloc_region_base(int region);
+size_t malloc_region_size(int region);
 void * malloc(size_t size);
+// malloc trying region first; a hint only, ignored by single region allocators
+void * malloc_region(size_t size, int region);
 void * calloc(size_t nmemb, size_t size);
 void * realloc(void * ptr, size_t size);
+// safe to call from interrupts; from an interrupt, or for another heap's
+// block, the block is only pushed onto its heap's lock-free remote list
+// and that heap frees it at its next allocating call. ISR pool blocks go
+// straight back to the pool.
 void free(void * ptr);
+// free with the size passed to the allocating call; plain free if unused
+void free_sized(void * ptr, size_t size);
+// n allocations of size bytes into out; returns how many succeeded
+// the fallback loop may leave NULLs anywhere in out, Valvano only at the end
+size_t malloc_batch(size_t size, size_t n, void ** out);
+// frees n pointers, skipping NULLs. ptrs is scratch space afterwards: pool
+// blocks and blocks of other heaps are routed as by free and moved to the
+// end, the default heap's own are sorted by address and freed in one
+// batch, and the ones that couldn't be freed are set to NULL.
+// From an interrupt every block is pushed as by free, ptrs is left as it
+// was, and neither the stats nor the call sites count the frees.
+void free_batch(void ** ptrs, size_t n);
+void * aligned_alloc(size_t alignment, size_t size);
+int posix_memalign(void ** memptr, size_t alignment, size_t size);
+// bytes usable in an allocated block; 0 for NULL or if the allocator can't
+// tell, see malloc_has_usable_size
+size_t malloc_usable_size(void * ptr);
 void malloc_reset(void);
 heap_stats malloc_stats(void);
+uint32_t malloc_last_cycles(void);
+heap_access malloc_last_accesses(void);
+// nonzero if the current allocator counts its metadata accesses
+int malloc_counts_accesses(void);
+// nonzero if the current allocator has native aligned allocation; without
+// it aligned_alloc always fails and posix_memalign returns EINVAL
+int malloc_has_aligned_alloc(void);
+// nonzero if malloc_usable_size can tell the size of the current allocator's blocks
+int malloc_has_usable_size(void);
+size_t malloc_largest_free(void);
+int malloc_walk(heap_walker walker, void * ctx);
+int malloc_validate(void);
+size_t malloc_metadata_bytes(void);
+// call site recording, off by default and not cleared by malloc_reset
+void malloc_record(int on);
+void malloc_record_clear(void);
+// copies up to max recorded sites into out, most cycles first; returns how many
+// dropped, if not NULL, gets the calls whose site didn't fit in the table
+int malloc_callsites(callsite * out, int max, uint32_t * dropped);
 void malloc_print_stats(void);
+
+// Allocator instances: each heap has its own allocator, memory, regions
+// and stats. The calls above without a heap argument act on the default
+// heap; the ones below work on any heap, the default one included.
+// Separate heaps can be used from separate tasks without sharing state.
+typedef struct _heap_instance heap_instance;
+// NULL if MALLOC_MAX_HEAPS are in use or impl can't use the memory.
+// A heap in the default heap's memory is destroyed when that is
+// reinitialized by malloc_init, malloc_init_region or malloc_reset.
+heap_instance * heap_create(heap_impl impl, void * base, size_t size);
+// the heap's blocks are abandoned with it; the default heap can't be destroyed
+void heap_destroy(heap_instance * heap);
+heap_instance * heap_default(void);
+void * heap_malloc(heap_instance * heap, size_t size);
+void * heap_calloc(heap_instance * heap, size_t nmemb, size_t size);
+// a block of another heap moves into heap and is queued back to its owner
+// as by free; that needs malloc_usable_size support in the owner's
+// allocator, without it the realloc fails and the block is left alone
+void * heap_realloc(heap_instance * heap, void * ptr, size_t size);
+void * heap_aligned_alloc(heap_instance * heap, size_t alignment, size_t size);
+// frees a block of any heap, from a task or an interrupt, like free(); a
+// block of another heap is queued for it without touching that heap
+void heap_free(heap_instance * heap, void * ptr);
+heap_stats heap_get_stats(heap_instance * heap);
+size_t heap_size(heap_instance * heap);
+size_t heap_largest_free(heap_instance * heap);
+int heap_walk(heap_instance * heap, heap_walker walker, void * ctx);
+int heap_validate(heap_instance * heap);
 void heap_stats_print(const heap_stats * stats);
 
+// ISR-safe allocation. Interrupt handlers never touch a heap: malloc,
+// malloc_region and calloc from an interrupt pop a block off a lock-free
+// pool reserved out of the default heap, and fail if the pool is empty,
+// missing or its blocks are too small. realloc from an interrupt only
+// succeeds within a pool block; aligned_alloc and malloc_batch fail.
+// Frees are safe anywhere, see free.
+typedef struct _isr_pool_stats
+{
+    uint32_t block_size;
+    uint32_t blocks;
+    uint32_t allocs;    // from interrupts
+    uint32_t fails;     // interrupt allocations the pool couldn't serve
+} isr_pool_stats;
+// replaces the pool with count blocks of block_size bytes, or just drops it
+// for 0; no interrupt may still hold an old pool block. 0 if ok, 1 if the
+// default heap can't hold the pool. malloc_init and malloc_reset drop it.
+int malloc_isr_pool(size_t block_size, size_t count);
+isr_pool_stats malloc_isr_pool_stats(void);
+
 #endif//__MALLOC_H__
@@ -120,8 +120,23 @@ void UART_OutChar(char data){
   UART0_DR_R = data;
 }
 
+static int Muted = 0;
+//------------UART_Mute------------
+// Discard (or resume) characters written through fputc()
+// UART_OutChar() is not affected
+// Input: mute is nonzero to discard printf() output
+// Output: the previous setting, to restore it with
+int UART_Mute(int mute){
+  int wasMuted = Muted;
+  Muted = mute;
+  return wasMuted;
+}
+
 // Print a character to UART.
 int fputc(int ch, FILE *f){
+  if(Muted){
+    return 1;
+  }
   if((ch == 10) || (ch == 13) || (ch == 27)){
     UART_OutChar(13);
     UART_OutChar(10);
@@ -4,12 +4,18 @@
 #include <string.h>
 #include <malloc.h>
 #include <command.h>
+#include <UART.h>
 
 #include "benchmarks/benchmarks.h"
 
 #define DEFAULT_SEED 0xDEADBEEF
 #define DEFAULT_ACTIONS (1 << 12)
 
+#define ARRAY_LEN(x) (sizeof(x)/sizeof(x[0]))
+
+// generated before a run so sampling stays out of the measured path
+static size_dist dist;
+
 static
 int random_sized(int argc, char ** argv)
 {
@@ -23,20 +29,37 @@ int random_sized(int argc, char ** argv)
 
     uint32_t seed = DEFAULT_SEED;
     uint32_t actions = DEFAULT_ACTIONS;
+    uint32_t max_ptrs = BENCH_RANDOM_PTRS;
     if (argc >= 2) {
         sscanf(argv[1], "%d", &seed);
         if (argc >= 3) {
             sscanf(argv[2], "%d", &actions);
+            if (argc >= 4) {
+                sscanf(argv[3], "%d", &max_ptrs);
+            }
         }
     }
     printf("Running random allocation benchmark:\n");
     printf("Seed: %d (0x%08X) \n", seed, seed);
     printf("Allocation sizes: %d to %d bytes:\n", lo, hi);
     printf("Number of repeated alloc/dealloc: %d \n", actions);
-    benchmark_random(seed, lo, hi, actions);
+    printf("Max live allocations: %d \n", max_ptrs);
+    dist_uniform(&dist, lo, hi);
+    benchmark_random(seed, &dist, LIFE_RANDOM, actions, max_ptrs);
     return 0;
 }
 
+// size_dist tables hold 16 bit sizes; larger ones can't come from heap_mem anyway
+static
+int sizes_ok(uint32_t lo, uint32_t hi)
+{
+    if (lo > DIST_MAX_SIZE || hi > DIST_MAX_SIZE) {
+        printf("Sizes are limited to %d bytes\n", DIST_MAX_SIZE);
+        return 0;
+    }
+    return 1;
+}
+
 static
 int random_verbose(int argc, char ** argv)
 {
@@ -46,11 +69,523 @@ int random_verbose(int argc, char ** argv)
     }
 
     uint32_t lo, hi, seed, actions;
+    uint32_t max_ptrs = BENCH_RANDOM_PTRS;
     sscanf(argv[1], "%d", &seed);
     sscanf(argv[2], "%d", &actions);
     sscanf(argv[3], "%d", &lo);
     sscanf(argv[4], "%d", &hi);
-    benchmark_random(seed, lo, hi, actions);
+    if (argc >= 6) {
+        sscanf(argv[5], "%d", &max_ptrs);
+    }
+    if (!sizes_ok(lo, hi))
+        return 1;
+    dist_uniform(&dist, lo, hi);
+    benchmark_random(seed, &dist, LIFE_RANDOM, actions, max_ptrs);
+    return 0;
+}
+
+static
+void print_dist_help(void)
+{
+    printf("Distributions:\n");
+    printf("    uniform <low> <high>\n");
+    printf("    exp <mean>\n");
+    printf("    lognormal <median> <sigma>\n");
+    printf("    bimodal <small> <large> <percent small>\n");
+    printf("    zipf <exponent>  : over 8B - 4KB size classes\n");
+    printf("    hist <size>:<count> ...\n");
+    printf("    trace            : histogram uploaded over the binary protocol\n");
+}
+
+#define MAX_HIST 16
+
+// fills dist from argv[0] (the distribution name) onward
+static
+int parse_dist(int argc, char ** argv, uint32_t seed)
+{
+    uint32_t a = 0, b = 0, c = 0;
+    float f = 0.0f;
+    const char * name = argv[0];
+
+    if (strcmp("uniform", name) == 0 && argc >= 3) {
+        sscanf(argv[1], "%d", &a);
+        sscanf(argv[2], "%d", &b);
+        if (!sizes_ok(a, b))
+            return 1;
+        dist_uniform(&dist, a, b);
+    } else if (strcmp("exp", name) == 0 && argc >= 2) {
+        sscanf(argv[1], "%d", &a);
+        if (!sizes_ok(a, a))
+            return 1;
+        dist_exponential(&dist, seed, a);
+    } else if (strcmp("lognormal", name) == 0 && argc >= 3) {
+        sscanf(argv[1], "%d", &a);
+        sscanf(argv[2], "%f", &f);
+        if (!sizes_ok(a, a))
+            return 1;
+        dist_lognormal(&dist, seed, a, f);
+    } else if (strcmp("bimodal", name) == 0 && argc >= 4) {
+        sscanf(argv[1], "%d", &a);
+        sscanf(argv[2], "%d", &b);
+        sscanf(argv[3], "%d", &c);
+        if (!sizes_ok(a, b))
+            return 1;
+        dist_bimodal(&dist, seed, a, b, c);
+    } else if (strcmp("zipf", name) == 0 && argc >= 2) {
+        sscanf(argv[1], "%f", &f);
+        dist_zipf(&dist, f);
+    } else if (strcmp("hist", name) == 0 && argc >= 2) {
+        uint16_t sizes[MAX_HIST];
+        uint32_t counts[MAX_HIST];
+        uint32_t n = 0;
+        for (int i = 1; i < argc && n < MAX_HIST; ++i) {
+            uint32_t size;
+            if (sscanf(argv[i], "%d:%d", &size, &counts[n]) == 2) {
+                if (!sizes_ok(size, size))
+                    return 1;
+                sizes[n++] = size;
+            }
+        }
+        if (dist_histogram(&dist, sizes, counts, n))
+            return 1;
+    } else if (strcmp("trace", name) == 0) {
+        const size_dist * trace = dist_trace();
+        if (trace == NULL) {
+            printf("No trace histogram has been uploaded\n");
+            return 1;
+        }
+        dist = *trace;
+    } else {
+        return 1;
+    }
+    return 0;
+}
+
+static
+int random_dist(int argc, char ** argv)
+{
+    if (argc <= 3) {
+        printf("Please provide seed, number of actions and a distribution\n");
+        print_dist_help();
+        return 1;
+    }
+
+    uint32_t seed, actions;
+    sscanf(argv[1], "%d", &seed);
+    sscanf(argv[2], "%d", &actions);
+    if (parse_dist(argc - 3, &argv[3], seed)) {
+        printf("Bad distribution: \"%s\"\n", argv[3]);
+        print_dist_help();
+        return 1;
+    }
+    dist_print(&dist);
+    benchmark_random(seed, &dist, LIFE_RANDOM, actions, BENCH_RANDOM_PTRS);
+    return 0;
+}
+
+static const char * lifetimes[] = {"random", "fifo", "lifo", "gen", "sized"};
+
+static
+int random_life(int argc, char ** argv)
+{
+    if (argc <= 4) {
+        printf("Please provide seed, number of actions, a lifetime and a distribution\n");
+        printf("Lifetimes: random, fifo, lifo, gen (generational), sized (small die young)\n");
+        print_dist_help();
+        return 1;
+    }
+
+    uint32_t seed, actions;
+    sscanf(argv[1], "%d", &seed);
+    sscanf(argv[2], "%d", &actions);
+
+    uint32_t life = 0;
+    while (life < ARRAY_LEN(lifetimes) && strcmp(lifetimes[life], argv[3]) != 0)
+        ++life;
+    if (life == ARRAY_LEN(lifetimes)) {
+        printf("Unrecognized lifetime: \"%s\"\n", argv[3]);
+        return 1;
+    }
+
+    if (parse_dist(argc - 4, &argv[4], seed)) {
+        printf("Bad distribution: \"%s\"\n", argv[4]);
+        print_dist_help();
+        return 1;
+    }
+    printf("Lifetime: %s\n", lifetimes[life]);
+    dist_print(&dist);
+    benchmark_random(seed, &dist, (lifetime) life, actions, BENCH_RANDOM_PTRS);
+    return 0;
+}
+
+static
+uint32_t avg(uint64_t total, uint32_t count)
+{
+    return (count > 0) ? (uint32_t) (total / count) : 0;
+}
+
+// grid axes for the sweep; actions double up to the given maximum
+static const uint32_t sweep_sizes[][2] = {{1, 16}, {1, 128}, {16, 512}, {256, 4096}};
+static const uint32_t sweep_ptrs[] = {16, 64, BENCH_RANDOM_PTRS, 1024, BENCH_RANDOM_MAX_PTRS};
+#define SWEEP_MIN_ACTIONS (1 << 8)
+
+static
+int random_sweep(int argc, char ** argv)
+{
+    uint32_t seeds = 2;
+    uint32_t max_actions = DEFAULT_ACTIONS;
+    if (argc >= 2) {
+        sscanf(argv[1], "%d", &seeds);
+        if (argc >= 3) {
+            sscanf(argv[2], "%d", &max_actions);
+        }
+    }
+
+    printf("Sweeping random benchmark: %d seeds, up to %d actions\n", seeds, max_actions);
+    printf("%5s %5s %7s %5s %10s | %8s %8s %8s %8s\n",
+           "low", "high", "actions", "ptrs", "seed",
+           "mallocs", "failed", "malloc", "free");
+    for (uint32_t s = 0; s < ARRAY_LEN(sweep_sizes); ++s) {
+        uint32_t lo = sweep_sizes[s][0];
+        uint32_t hi = sweep_sizes[s][1];
+        for (uint32_t actions = SWEEP_MIN_ACTIONS; actions <= max_actions; actions <<= 1) {
+            for (uint32_t p = 0; p < ARRAY_LEN(sweep_ptrs); ++p) {
+                for (uint32_t i = 0; i < seeds; ++i) {
+                    uint32_t seed = DEFAULT_SEED + i;
+
+                    dist_uniform(&dist, lo, hi);
+                    malloc_reset();
+                    benchmark_random(seed, &dist, LIFE_RANDOM, actions, sweep_ptrs[p]);
+                    heap_stats stats = malloc_stats();
+
+                    printf("%5d %5d %7d %5d %10u | %8d %8d %8d %8d\n",
+                           lo, hi, actions, sweep_ptrs[p], seed,
+                           stats.malloc.sn, stats.malloc.fn,
+                           avg(stats.malloc.st, stats.malloc.sn),
+                           avg(stats.free.st, stats.free.sn));
+                }
+            }
+        }
+    }
+    puts("(malloc/free columns are average cycles of successful calls)");
+    return 0;
+}
+
+// matrix cells; each run gets a seed and an action count
+static
+void matrix_random_sm(uint32_t seed, uint32_t actions)
+{
+    dist_uniform(&dist, 1, 128);
+    benchmark_random(seed, &dist, LIFE_RANDOM, actions, BENCH_RANDOM_PTRS);
+}
+
+static
+void matrix_random_lg(uint32_t seed, uint32_t actions)
+{
+    dist_uniform(&dist, 256, 4096);
+    benchmark_random(seed, &dist, LIFE_RANDOM, actions, BENCH_RANDOM_PTRS);
+}
+
+static
+void matrix_generational(uint32_t seed, uint32_t actions)
+{
+    dist_exponential(&dist, seed, 64);
+    benchmark_random(seed, &dist, LIFE_GENERATIONAL, actions, BENCH_RANDOM_PTRS);
+}
+
+static
+void matrix_rtos(uint32_t seed, uint32_t actions)
+{
+    benchmark_rtos(seed, 4, 2, actions);
+}
+
+typedef struct _matrix_bench
+{
+    const char * name;
+    void (* run) (uint32_t seed, uint32_t actions);
+} matrix_bench;
+
+static const matrix_bench matrix_benches[] =
+{
+    {"random-sm", matrix_random_sm},
+    {"random-lg", matrix_random_lg},
+    {"gen-exp", matrix_generational},
+    {"rtos", matrix_rtos},
+};
+static const heap_impl matrix_impls[] = {IMPL_VALVANO, IMPL_BRANDON_KNUTH};
+static const char * matrix_impl_names[] = {"valvano", "knuth"};
+static const uint32_t matrix_heap_sizes[] = {MALLOC_SIZE / 4, MALLOC_SIZE / 2, MALLOC_SIZE};
+
+// every allocator x benchmark x seed x heap size, one after another; each
+// cell starts from a freshly placed heap and zeroed stats, and benchmark
+// output is muted so only the merged report is printed
+static
+int matrix(int argc, char ** argv)
+{
+    uint32_t seeds = 2;
+    uint32_t actions = DEFAULT_ACTIONS;
+    if (argc >= 2) {
+        sscanf(argv[1], "%d", &seeds);
+        if (argc >= 3) {
+            sscanf(argv[2], "%d", &actions);
+        }
+    }
+
+    heap_impl impl = malloc_current_impl();
+    int regions = malloc_num_regions();
+    void * bases[MALLOC_MAX_REGIONS];
+    size_t sizes[MALLOC_MAX_REGIONS];
+    for (int r = 0; r < regions; ++r) {
+        bases[r] = malloc_region_base(r);
+        sizes[r] = malloc_region_size(r);
+    }
+
+    printf("Benchmark matrix: %d seeds, %d actions per run\n", seeds, actions);
+    printf("%-8s %-10s %6s %10s | %8s %8s %8s %8s %8s\n",
+           "alloc", "bench", "heap", "seed",
+           "mallocs", "failed", "malloc", "free", "realloc");
+    for (uint32_t a = 0; a < ARRAY_LEN(matrix_impls); ++a) {
+        for (uint32_t b = 0; b < ARRAY_LEN(matrix_benches); ++b) {
+            for (uint32_t h = 0; h < ARRAY_LEN(matrix_heap_sizes); ++h) {
+                for (uint32_t i = 0; i < seeds; ++i) {
+                    uint32_t seed = DEFAULT_SEED + i;
+
+                    if (malloc_init_region(matrix_impls[a], heap_mem, matrix_heap_sizes[h])) {
+                        printf("%-8s %-10s %6d %10u | skipped, the heap can't be set up\n",
+                               matrix_impl_names[a], matrix_benches[b].name,
+                               matrix_heap_sizes[h], seed);
+                        continue;
+                    }
+                    // binary mode is muted already and must stay so
+                    int muted = UART_Mute(1);
+                    matrix_benches[b].run(seed, actions);
+                    UART_Mute(muted);
+                    heap_stats stats = malloc_stats();
+
+                    printf("%-8s %-10s %6d %10u | %8d %8d %8d %8d %8d\n",
+                           matrix_impl_names[a], matrix_benches[b].name,
+                           matrix_heap_sizes[h], seed,
+                           stats.malloc.sn, stats.malloc.fn,
+                           avg(stats.malloc.st, stats.malloc.sn),
+                           avg(stats.free.st, stats.free.sn),
+                           avg(stats.realloc.st, stats.realloc.sn));
+                }
+            }
+        }
+    }
+    puts("(malloc/free/realloc columns are average cycles of successful calls)");
+
+    // back to the heap the matrix started from, extra regions included
+    if (malloc_init_region(impl, bases[0], sizes[0])) {
+        puts("Couldn't restore the heap, use heap-size to set it up");
+        return 1;
+    }
+    for (int r = 1; r < regions; ++r) {
+        malloc_add_region(bases[r], sizes[r]);
+    }
+    return 0;
+}
+
+static
+int realloc_grow(int argc, char ** argv)
+{
+    static const char * policies[] = {"exact", "add", "1.5x", "2x"};
+    uint32_t policy = GROW_2X;
+    uint32_t buffers = 8;
+    uint32_t max_size = 2048;
+    uint32_t step = 64;
+
+    if (argv[0][0] == 's') {
+        // string builder: every append reallocs to fit
+        policy = GROW_EXACT;
+        if (argc >= 2) {
+            sscanf(argv[1], "%d", &buffers);
+            if (argc >= 3) {
+                sscanf(argv[2], "%d", &max_size);
+            }
+        }
+    } else if (argc >= 2) {
+        for (policy = 0; policy < ARRAY_LEN(policies); ++policy) {
+            if (strcmp(policies[policy], argv[1]) == 0)
+                break;
+        }
+        if (policy == ARRAY_LEN(policies)) {
+            printf("Unrecognized growth policy: \"%s\"\n", argv[1]);
+            return 1;
+        }
+        if (argc >= 3) {
+            sscanf(argv[2], "%d", &buffers);
+            if (argc >= 4) {
+                sscanf(argv[3], "%d", &max_size);
+                if (argc >= 5) {
+                    sscanf(argv[4], "%d", &step);
+                }
+            }
+        }
+    }
+
+    printf("Growing %d interleaved buffers to %d bytes, growth: %s", buffers, max_size, policies[policy]);
+    if (policy == GROW_ADD)
+        printf(" %dB", step);
+    printf("\n");
+    benchmark_realloc((growth) policy, buffers, max_size, step);
+    return 0;
+}
+
+static
+int frag_adversary(int argc, char ** argv)
+{
+    uint32_t small = 16;
+    uint32_t large = 256;
+    if (argc >= 2) {
+        sscanf(argv[1], "%d", &small);
+        if (argc >= 3) {
+            sscanf(argv[2], "%d", &large);
+        }
+    }
+    if (small == 0 || large == 0) {
+        printf("Please provide nonzero sizes\n");
+        return 1;
+    }
+
+    printf("Adversarial fragmentation, small %dB, large %dB\n", small, large);
+    benchmark_frag(small, large);
+    return 0;
+}
+
+static
+int soak(int argc, char ** argv)
+{
+    uint32_t ops = 1000000;
+    uint32_t window = 10000;
+    uint32_t lo = 8;
+    uint32_t hi = 512;
+    if (argc >= 2) {
+        sscanf(argv[1], "%d", &ops);
+        if (argc >= 3) {
+            sscanf(argv[2], "%d", &window);
+            if (argc >= 5) {
+                sscanf(argv[3], "%d", &lo);
+                sscanf(argv[4], "%d", &hi);
+            }
+        }
+    }
+    if (window == 0)
+        window = ops;
+
+    if (!sizes_ok(lo, hi))
+        return 1;
+
+    printf("Soaking for %d ops, %d to %d bytes, reporting every %d ops\n", ops, lo, hi, window);
+    printf("(latencies in cycles; lfree is the largest possible allocation)\n");
+    dist_uniform(&dist, lo, hi);
+    benchmark_soak(DEFAULT_SEED, &dist, ops, window);
+    return 0;
+}
+
+static
+int rtos_messages(int argc, char ** argv)
+{
+    uint32_t producers = 4;
+    uint32_t consumers = 2;
+    uint32_t messages = 10000;
+    if (argc >= 2) {
+        sscanf(argv[1], "%d", &producers);
+        if (argc >= 3) {
+            sscanf(argv[2], "%d", &consumers);
+            if (argc >= 4) {
+                sscanf(argv[3], "%d", &messages);
+            }
+        }
+    }
+
+    printf("Passing %d messages from %d producer to %d consumer tasks\n", messages, producers, consumers);
+    benchmark_rtos(DEFAULT_SEED, producers, consumers, messages);
+    return 0;
+}
+
+static
+int larson(int argc, char ** argv)
+{
+    uint32_t tasks = LARSON_MAX_TASKS;
+    uint32_t turns = 20000;
+    uint32_t lo = 8;
+    uint32_t hi = 256;
+    if (argc >= 2) {
+        sscanf(argv[1], "%d", &tasks);
+        if (argc >= 3) {
+            sscanf(argv[2], "%d", &turns);
+            if (argc >= 5) {
+                sscanf(argv[3], "%d", &lo);
+                sscanf(argv[4], "%d", &hi);
+            }
+        }
+    }
+    if (turns == 0) {
+        printf("Please provide a nonzero number of turns\n");
+        return 1;
+    }
+    if (!sizes_ok(lo, hi))
+        return 1;
+
+    printf("Larson server workload, 1 to %d tasks, %d turns, %d to %d bytes\n", tasks, turns, lo, hi);
+    dist_uniform(&dist, lo, hi);
+    benchmark_larson(DEFAULT_SEED, &dist, tasks, turns);
+    return 0;
+}
+
+static
+int isr_latency(int argc, char ** argv)
+{
+    uint32_t count = 2000;
+    uint32_t period = 4000;
+    uint32_t blocks = 16;
+    if (argc >= 2) {
+        sscanf(argv[1], "%d", &count);
+        if (argc >= 3) {
+            sscanf(argv[2], "%d", &period);
+            if (argc >= 4) {
+                sscanf(argv[3], "%d", &blocks);
+            }
+        }
+    }
+    // the handler has to be done well before the next timeout
+    if (period < 1000) {
+        printf("Please provide a period of at least 1000 cycles\n");
+        return 1;
+    }
+
+    printf("%d interrupts every %d cycles, %d pool blocks\n", count, period, blocks);
+    benchmark_isr(count, period, blocks);
+    return 0;
+}
+
+static
+int align_tax(int argc, char ** argv)
+{
+    uint32_t count = 256;
+    uint32_t lo = 16;
+    uint32_t hi = 128;
+    if (argc >= 2) {
+        sscanf(argv[1], "%d", &count);
+        if (argc >= 4) {
+            sscanf(argv[2], "%d", &lo);
+            sscanf(argv[3], "%d", &hi);
+        }
+    }
+    if (count == 0) {
+        printf("Please provide a nonzero number of blocks\n");
+        return 1;
+    }
+    if (!sizes_ok(lo, hi))
+        return 1;
+    if (lo > hi) {
+        printf("Low size must not be above high size\n");
+        return 1;
+    }
+
+    printf("Aligned allocation of %d blocks, %d to %d bytes\n", count, lo, hi);
+    benchmark_align(count, lo, hi);
     return 0;
 }
 
@@ -77,7 +612,12 @@ int fixed_alloc(int argc, char ** argv)
         }
     }
 
-    benchmark_fixed(size, amount);
+    if (strcmp("fixed-batch", argv[0]) == 0)
+        benchmark_fixed_batch(size, amount);
+    else if (strcmp("fixed-sized", argv[0]) == 0)
+        benchmark_fixed_sized(size, amount);
+    else
+        benchmark_fixed(size, amount);
 }
 
 static
@@ -86,23 +626,42 @@ int tokenizer_case(int argc, char ** argv)
     benchmark_tokenize();
 }
 
+static
+int tokenizer_batch_case(int argc, char ** argv)
+{
+    benchmark_tokenize_batch();
+}
+
 static
 int tokenizer_bst_case(int argc, char ** argv)
 {
     benchmark_tokenize_bst();
 }
 
-#define ARRAY_LEN(x) (sizeof(x)/sizeof(x[0]))
-
 static
 const command cmds[] =
 {
-    {"random", "<seed (dec)> <num actions> <low> <high>", "random (low B- high B) allocations", random_verbose},
-    {"random-sm", "[seed (dec)] [num actions]", "random small (1B - 128B) allocations", random_sized},
-    {"random-lg", "[seed (dec)] [num actions]", "random large (256B - 4KB) allocations", random_sized},
+    {"random", "<seed (dec)> <num actions> <low> <high> [max live (def 256)]", "random (low B- high B) allocations", random_verbose},
+    {"random-sm", "[seed (dec)] [num actions] [max live (def 256)]", "random small (1B - 128B) allocations", random_sized},
+    {"random-lg", "[seed (dec)] [num actions] [max live (def 256)]", "random large (256B - 4KB) allocations", random_sized},
+    {"random-dist", "<seed (dec)> <num actions> <distribution> [params]", "random allocations with skewed sizes", random_dist},
+    {"random-life", "<seed (dec)> <num actions> <lifetime> <distribution> [params]", "random allocations with a lifetime policy", random_life},
+    {"sweep", "[num seeds (def 2)] [max actions (def 4096)]", "random benchmark over a grid of sizes, actions, live pointers and seeds", random_sweep},
+    {"matrix", "[num seeds (def 2)] [actions (def 4096)]", "every allocator x benchmark x seed x heap size, merged into one report", matrix},
+    {"realloc", "[exact|add|1.5x|2x (def 2x)] [buffers (def 8)] [max size (def 2048)] [step (def 64)]", "Grows interleaved buffers with realloc", realloc_grow},
+    {"strbuild", "[buffers (def 8)] [max size (def 2048)]", "String builders that realloc on every append", realloc_grow},
+    {"frag", "[small (def 16)] [large (def 256)]", "Pathological fragmentation patterns, reports smallest failing request", frag_adversary},
+    {"soak", "[ops (def 1000000)] [window (def 10000)] [low high (def 8 512)]", "Long mixed workload with per-window latency percentiles and fragmentation", soak},
+    {"rtos", "[producers (def 4)] [consumers (def 2)] [messages (def 10000)]", "RTOS message buffers passed through FIFOs, freed out of order", rtos_messages},
+    {"larson", "[max tasks (def 7)] [turns (def 20000)] [low high (def 8 256)]", "Cross-task frees, one locked heap vs per-task arenas with remote-free queues", larson},
+    {"isr", "[interrupts (def 2000)] [period (def 4000)] [pool blocks (def 16)]", "Interrupt latency with handlers allocating from the ISR pool", isr_latency},
+    {"align", "[count (def 256)] [low high (def 16 128)]", "Alignment tax of aligned_alloc from 4 to 64 bytes", align_tax},
     {"vector", "[num pushes (def 4096)]", "Pushes random ints into libbtn's vector", vector_push},
     {"fixed", "[size (def 64)] [num mallocs (def 1024)]", "Allocates fixed sizes then frees them", fixed_alloc},
+    {"fixed-sized", "[size (def 64)] [num mallocs (def 1024)]", "fixed, freeing with free_sized", fixed_alloc},
+    {"fixed-batch", "[size (def 64)] [num mallocs (def 1024)]", "fixed, using malloc_batch and free_batch", fixed_alloc},
     {"tokenize", "", "String tokenizer use case", tokenizer_case},
+    {"tokenize-batch", "", "String tokenizer use case, tokens freed with free_batch", tokenizer_batch_case},
     {"tokenize-bst", "", "String tokenizer with BST map", tokenizer_bst_case},
 };
 
@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <malloc.h>
+#include <Random.h>
+
+#include "benchmarks.h"
+
+// Alignment tax: the same allocation sequence at increasing alignments,
+// each on a fresh heap. Reports time per allocation and how much of the
+// heap went to slack and metadata instead of the requested bytes.
+
+#define ALIGN_PTRS 1024
+
+static void * ptrs[ALIGN_PTRS];
+static const uint32_t alignments[] = {4, 8, 16, 32, 64};
+#define ALIGNMENTS (sizeof(alignments)/sizeof(alignments[0]))
+
+static
+void sum_free(void * ptr, size_t size, int used, void * ctx)
+{
+    if (!used)
+        *(uint32_t *) ctx += size;
+}
+
+void benchmark_align(uint32_t count, uint32_t lo, uint32_t hi)
+{
+    if (count == 0 || lo > hi)
+        return;
+    if (count > ALIGN_PTRS)
+        count = ALIGN_PTRS;
+    if (!malloc_has_aligned_alloc()) {
+        puts("This allocator has no aligned allocation, aligned_alloc always fails");
+        return;
+    }
+
+    printf("%5s | %6s %6s %8s | %8s %8s %8s\n",
+           "align", "allocs", "failed", "cycles", "request", "consumed", "tax");
+    for (uint32_t a = 0; a < ALIGNMENTS; ++a) {
+        uint32_t requested = 0;
+        uint32_t allocs = 0;
+        uint32_t failed = 0;
+        uint64_t cycles = 0;
+
+        malloc_reset();
+        Random_Init(0xDEADBEEF);
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t size = (Random() >> 8) % (hi + 1 - lo) + lo;
+            ptrs[i] = aligned_alloc(alignments[a], size);
+            cycles += malloc_last_cycles();
+            if (ptrs[i] != NULL) {
+                requested += size;
+                ++allocs;
+            } else {
+                ++failed;
+            }
+        }
+
+        // heap consumed: everything that isn't in a free block
+        uint32_t free_bytes = 0;
+        if (malloc_walk(sum_free, &free_bytes) != 0)
+            free_bytes = malloc_largest_free();
+        uint32_t consumed = malloc_heap_size() - free_bytes;
+
+        printf("%5d | %6d %6d %8d | %8d %8d %7d%%\n",
+               alignments[a], allocs, failed, (uint32_t) (cycles / count),
+               requested, consumed,
+               (requested > 0) ? (consumed - requested) * 100 / requested : 0);
+
+        for (uint32_t i = 0; i < count; ++i) {
+            if (ptrs[i] != NULL)
+                free(ptrs[i]);
+        }
+    }
+    puts("(cycles per aligned_alloc; tax is consumed over requested bytes)");
+}
@@ -47,6 +47,33 @@ void benchmark_fixed(uint32_t size, uint32_t actions)
     free(ptrs);
 }
 
+void benchmark_fixed_sized(uint32_t size, uint32_t actions)
+{
+    printf("Allocating %dB objects %d times, freeing with their size\n", size, actions);
+    void ** ptrs = (void **) malloc(sizeof(void *) * actions);
+
+    for (uint32_t i = 0; i < actions; ++i) {
+        ptrs[i] = (void *) malloc(size);
+    }
+
+    for (uint32_t i = 0; i < actions; ++i) {
+        free_sized(ptrs[i], size);
+    }
+
+    free_sized(ptrs, sizeof(void *) * actions);
+}
+
+void benchmark_fixed_batch(uint32_t size, uint32_t actions)
+{
+    printf("Allocating %dB objects %d times in one batch\n", size, actions);
+    void ** ptrs = (void **) malloc(sizeof(void *) * actions);
+
+    malloc_batch(size, actions, ptrs);
+    free_batch(ptrs, actions);
+
+    free(ptrs);
+}
+
 const char * lorem = "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip ex ea commodo consequat. Duis aute irure dolor in reprehenderit in voluptate velit esse cillum dolore eu fugiat nulla pariatur. Excepteur sint occaecat cupidatat non proident, sunt in culpa qui officia deserunt mollit anim id est laborum.";
 // http://www.perseus.tufts.edu/hopper/text?doc=Perseus:text:1999.02.0055
 const char * aenied =
@@ -75,6 +102,20 @@ void benchmark_tokenize(void)
     tokenizer_dtor(&tok);
 }
 
+void benchmark_tokenize_batch(void)
+{
+    puts("Tokenizing first 101 lines of \"The Aenied\", copying strings to array and freeing them in one batch");
+    tokenizer tok;
+    tokenizer_ctor(&tok, aenied, " ");
+    
+    char ** tokens = tokenizer_tokens_copy(&tok);
+    size_t num_tok = tokenizer_num_tokens(&tok);
+    free_batch((void **) tokens, num_tok);
+    free(tokens);
+
+    tokenizer_dtor(&tok);
+}
+
 void benchmark_tokenize_bst(void)
 {
     puts("Tokenizing first 101 lines of \"The Aenied\" and adding them to a BST");
@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+#include <Random.h>
+
+#include "benchmarks.h"
+
+// Size distributions are generated up front into a table of
+// DIST_TABLE_LEN samples; benchmarks draw a size with one random index so
+// the cost of the distribution never shows up in the measured path.
+
+// uniform in (0, 1)
+static
+float rand_unit(void)
+{
+    uint32_t val = Random() >> 8;
+    return ((float) val + 0.5f) / (float) (1 << 24);
+}
+
+// standard normal, Box-Muller
+static
+float rand_normal(void)
+{
+    float u1 = rand_unit();
+    float u2 = rand_unit();
+    return sqrtf(-2.0f * logf(u1)) * cosf(6.2831853f * u2);
+}
+
+// the commands reject parameters above DIST_MAX_SIZE, so only the far
+// tail of a sampled distribution is cut here
+static
+uint16_t clamp_size(float size)
+{
+    if (size < 1.0f)
+        return 1;
+    if (size > DIST_MAX_SIZE)
+        return DIST_MAX_SIZE;
+    return (uint16_t) (size + 0.5f);
+}
+
+void dist_uniform(size_dist * dist, uint32_t lo, uint32_t hi)
+{
+    dist->name = "uniform";
+    if (lo > hi) {
+        uint32_t tmp = lo;
+        lo = hi;
+        hi = tmp;
+    }
+    // exact quantiles; no sampling noise
+    for (uint32_t i = 0; i < DIST_TABLE_LEN; ++i) {
+        uint32_t size = lo + (uint32_t) ((uint64_t) (hi + 1 - lo) * i / DIST_TABLE_LEN);
+        dist->table[i] = clamp_size((float) size);
+    }
+}
+
+void dist_exponential(size_dist * dist, uint32_t seed, uint32_t mean)
+{
+    dist->name = "exponential";
+    Random_Init(seed);
+    for (uint32_t i = 0; i < DIST_TABLE_LEN; ++i) {
+        dist->table[i] = clamp_size(-(float) mean * logf(rand_unit()));
+    }
+}
+
+void dist_lognormal(size_dist * dist, uint32_t seed, uint32_t median, float sigma)
+{
+    dist->name = "log-normal";
+    Random_Init(seed);
+    float mu = logf((float) median);
+    for (uint32_t i = 0; i < DIST_TABLE_LEN; ++i) {
+        dist->table[i] = clamp_size(expf(mu + sigma * rand_normal()));
+    }
+}
+
+void dist_bimodal(size_dist * dist, uint32_t seed, uint32_t small, uint32_t large, uint32_t percent_small)
+{
+    dist->name = "bimodal";
+    Random_Init(seed);
+    // each mode is a normal with a standard deviation of 1/8 of its mean
+    for (uint32_t i = 0; i < DIST_TABLE_LEN; ++i) {
+        uint32_t mode = (rand_unit() * 100.0f < percent_small) ? small : large;
+        dist->table[i] = clamp_size(mode + mode / 8.0f * rand_normal());
+    }
+}
+
+static const uint16_t zipf_classes[] =
+{
+    8, 16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512, 1024, 2048, 4096
+};
+#define ZIPF_CLASSES (sizeof(zipf_classes)/sizeof(zipf_classes[0]))
+
+void dist_zipf(size_dist * dist, float s)
+{
+    float weights[ZIPF_CLASSES];
+    float total = 0.0f;
+
+    dist->name = "zipf";
+    // rank k (from 1) has weight 1/k^s, smallest class is the most popular
+    for (uint32_t k = 0; k < ZIPF_CLASSES; ++k) {
+        weights[k] = 1.0f / powf((float) (k + 1), s);
+        total += weights[k];
+    }
+
+    // lay the classes out by their share of the table
+    uint32_t i = 0;
+    float cumulative = 0.0f;
+    for (uint32_t k = 0; k < ZIPF_CLASSES; ++k) {
+        cumulative += weights[k];
+        uint32_t end = (uint32_t) (cumulative / total * DIST_TABLE_LEN + 0.5f);
+        for (; i < end && i < DIST_TABLE_LEN; ++i) {
+            dist->table[i] = zipf_classes[k];
+        }
+    }
+    for (; i < DIST_TABLE_LEN; ++i) {
+        dist->table[i] = zipf_classes[ZIPF_CLASSES - 1];
+    }
+}
+
+int dist_histogram(size_dist * dist, const uint16_t * sizes, const uint32_t * counts, uint32_t n)
+{
+    uint32_t total = 0;
+    for (uint32_t k = 0; k < n; ++k) {
+        total += counts[k];
+    }
+    if (total == 0)
+        return 1;
+
+    dist->name = "histogram";
+    uint32_t i = 0;
+    uint32_t cumulative = 0;
+    for (uint32_t k = 0; k < n; ++k) {
+        cumulative += counts[k];
+        uint32_t end = (uint32_t) ((uint64_t) cumulative * DIST_TABLE_LEN / total);
+        for (; i < end && i < DIST_TABLE_LEN; ++i) {
+            dist->table[i] = (sizes[k] > 0) ? sizes[k] : 1;
+        }
+    }
+    return 0;
+}
+
+// histogram uploaded from a host trace, see the binary protocol
+static size_dist trace_dist;
+static int trace_loaded = 0;
+
+int dist_load_trace(const uint16_t * sizes, const uint32_t * counts, uint32_t n)
+{
+    if (dist_histogram(&trace_dist, sizes, counts, n))
+        return 1;
+    trace_dist.name = "trace";
+    trace_loaded = 1;
+    return 0;
+}
+
+const size_dist * dist_trace(void)
+{
+    return trace_loaded ? &trace_dist : NULL;
+}
+
+void dist_print(const size_dist * dist)
+{
+    uint32_t lo = DIST_MAX_SIZE;
+    uint32_t hi = 0;
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < DIST_TABLE_LEN; ++i) {
+        uint32_t size = dist->table[i];
+        lo = (size < lo) ? size : lo;
+        hi = (size > hi) ? size : hi;
+        total += size;
+    }
+    printf("Size distribution: %s, %d to %d bytes, mean %d bytes\n",
+           dist->name, lo, hi, total / DIST_TABLE_LEN);
+}
@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <malloc.h>
+
+#include "benchmarks.h"
+
+// Adversarial fragmentation patterns. Each pattern pins live blocks so
+// that the free memory is split into holes, then the smallest request
+// that fails is found while plenty of memory is nominally free.
+
+#define FRAG_PTRS 4096
+
+static void * ptrs[FRAG_PTRS];
+static uint32_t sizes[FRAG_PTRS];
+static uint32_t num_ptrs = 0;
+
+static
+void hold(void * ptr, uint32_t size)
+{
+    ptrs[num_ptrs] = ptr;
+    sizes[num_ptrs] = size;
+    ++num_ptrs;
+}
+
+// drops the released blocks from the table, keeping address order
+static
+void compact(void)
+{
+    uint32_t j = 0;
+    for (uint32_t i = 0; i < num_ptrs; ++i) {
+        if (ptrs[i] != NULL) {
+            ptrs[j] = ptrs[i];
+            sizes[j] = sizes[i];
+            ++j;
+        }
+    }
+    num_ptrs = j;
+}
+
+// insertion sort; first fit hands out mostly ascending addresses already
+static
+void sort_by_address(void)
+{
+    for (uint32_t i = 1; i < num_ptrs; ++i) {
+        void * ptr = ptrs[i];
+        uint32_t size = sizes[i];
+        uint32_t j = i;
+        for (; j > 0 && (uint8_t *) ptrs[j - 1] > (uint8_t *) ptr; --j) {
+            ptrs[j] = ptrs[j - 1];
+            sizes[j] = sizes[j - 1];
+        }
+        ptrs[j] = ptr;
+        sizes[j] = size;
+    }
+}
+
+static
+void release(uint32_t i)
+{
+    free(ptrs[i]);
+    ptrs[i] = NULL;
+}
+
+static
+uint32_t held_bytes(void)
+{
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < num_ptrs; ++i) {
+        if (ptrs[i] != NULL)
+            total += sizes[i];
+    }
+    return total;
+}
+
+static
+void report(const char * pattern)
+{
+    uint32_t held = held_bytes();
+    uint32_t free_bytes = malloc_heap_size() - held;
+    uint32_t fits = malloc_largest_free();
+
+    printf("%s: %d blocks holding %d bytes, %d bytes nominally free\n",
+           pattern, num_ptrs, held, free_bytes);
+    printf("    smallest failing request: %d bytes (%d%% of free memory)\n",
+           fits + 1, (uint32_t) ((uint64_t) (fits + 1) * 100 / free_bytes));
+}
+
+static
+void release_all(void)
+{
+    for (uint32_t i = 0; i < num_ptrs; ++i) {
+        if (ptrs[i] != NULL)
+            release(i);
+    }
+    num_ptrs = 0;
+}
+
+// small/large pairs until the heap is full, then free every large block
+// so the holes are exactly one large block wide
+static
+void alternate(uint32_t small, uint32_t large)
+{
+    while (num_ptrs + 2 <= FRAG_PTRS) {
+        void * s = malloc(small);
+        if (s == NULL)
+            break;
+        hold(s, small);
+        void * l = malloc(large);
+        if (l == NULL)
+            break;
+        hold(l, large);
+    }
+    for (uint32_t i = 1; i < num_ptrs; i += 2) {
+        release(i);
+    }
+    compact();
+}
+
+// Robson-style: fill the heap with blocks of one size, then keep only one
+// block per window of the next (doubled) size so no hole can hold it
+// comfortably, and repeat with the doubled size
+static
+void robson(uint32_t base)
+{
+    for (uint32_t size = base; size <= malloc_heap_size() / 8; size *= 2) {
+        while (num_ptrs < FRAG_PTRS) {
+            void * ptr = malloc(size);
+            if (ptr == NULL)
+                break;
+            hold(ptr, size);
+        }
+
+        uint32_t window = size * 2;
+        uint32_t last_window = -1;
+        // blocks are visited in address order so one survives per window
+        sort_by_address();
+        for (uint32_t i = 0; i < num_ptrs; ++i) {
+            uint32_t w = ((uint8_t *) ptrs[i] - (uint8_t *) malloc_heap_base()) / window;
+            if (w == last_window)
+                release(i);
+            else
+                last_window = w;
+        }
+        compact();
+    }
+}
+
+void benchmark_frag(uint32_t small, uint32_t large)
+{
+    num_ptrs = 0;
+    alternate(small, large);
+    report("alternating");
+    release_all();
+
+    robson(small);
+    report("robson");
+    release_all();
+}
@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <malloc.h>
+#include <Random.h>
+#include <tm4c1294ncpdt.h>
+
+#include "benchmarks.h"
+
+// Interrupt latency under allocator load. Timer 0A interrupts periodically
+// in place of a UART or CAN receive interrupt: its handler takes a message
+// buffer with malloc (served by the ISR pool) and posts it to the task, then
+// frees a transmit buffer the task allocated from the heap (queued on the
+// heap's remote-free list). Latency is how long after the timer ran out the
+// handler starts, read from the timer itself since the allocator wrappers
+// reset SysTick on every call. The task loop is one of:
+//   idle:   no allocator work, the baseline latency of this setup
+//   safe:   random malloc/free on the default heap, handling the messages
+//   locked: the same with every task call in a critical section, as a
+//           global lock shared with the handlers would need
+
+#define ISR_SLOTS 64
+#define ISR_MSG_SIZE 64     // largest CAN FD frame
+#define RING_LEN 16         // must be a power of 2
+#define TIMER0A_IRQ 19
+#define ISR_PRIORITY 2
+
+// startup.s
+long StartCritical(void);
+void EndCritical(long sr);
+
+// one producer and one consumer, on one core: no locking needed
+typedef struct _ring
+{
+    void * volatile slots[RING_LEN];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+} ring;
+
+typedef enum _isr_mode
+{
+    MODE_IDLE,
+    MODE_SAFE,
+    MODE_LOCKED
+} isr_mode;
+
+static const char * mode_names[] = {"idle", "safe", "locked"};
+
+static ring rx;     // handler to task
+static ring tx;     // task to handler
+static latency entry_lat;
+static latency handler_lat;
+static volatile uint32_t irqs = 0;
+static uint32_t period = 0;
+static void * slots[ISR_SLOTS];
+
+static
+int ring_put(ring * r, void * ptr)
+{
+    if (r->head - r->tail == RING_LEN)
+        return 0;
+    r->slots[r->head % RING_LEN] = ptr;
+    ++r->head;
+    return 1;
+}
+
+static
+void * ring_get(ring * r)
+{
+    if (r->head == r->tail)
+        return NULL;
+    void * ptr = r->slots[r->tail % RING_LEN];
+    ++r->tail;
+    return ptr;
+}
+
+// cycles between two reads of the down counting timer, at most one reload apart
+static
+uint32_t timer_elapsed(uint32_t from, uint32_t to)
+{
+    return (from >= to) ? from - to : from + period - to;
+}
+
+void Timer0A_Handler(void)
+{
+    uint32_t now = TIMER0_TAR_R;
+    TIMER0_ICR_R = TIMER_ICR_TATOCINT;     // acknowledge the timeout
+    latency_add(&entry_lat, timer_elapsed(period - 1, now));
+
+    uint32_t start = TIMER0_TAR_R;
+    uint8_t * msg = malloc(ISR_MSG_SIZE);
+    if (msg != NULL) {
+        msg[0] = irqs;
+        if (!ring_put(&rx, msg))
+            free(msg);
+    }
+    void * sent = ring_get(&tx);
+    if (sent != NULL)
+        free(sent);
+    latency_add(&handler_lat, timer_elapsed(start, TIMER0_TAR_R));
+    ++irqs;
+}
+
+static
+void timer_start(void)
+{
+    SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R0;
+    while ((SYSCTL_PRTIMER_R & SYSCTL_PRTIMER_R0) == 0);
+    TIMER0_CTL_R = 0;                       // disable during setup
+    TIMER0_CFG_R = TIMER_CFG_32_BIT_TIMER;
+    TIMER0_TAMR_R = TIMER_TAMR_TAMR_PERIOD;
+    TIMER0_TAILR_R = period - 1;
+    TIMER0_ICR_R = TIMER_ICR_TATOCINT;
+    TIMER0_IMR_R = TIMER_IMR_TATOIM;
+    NVIC_PRI4_R = (NVIC_PRI4_R & ~NVIC_PRI4_INT19_M) | (ISR_PRIORITY << 29);
+    NVIC_EN0_R = 1 << TIMER0A_IRQ;
+    TIMER0_CTL_R = TIMER_CTL_TAEN;
+}
+
+static
+void timer_stop(void)
+{
+    TIMER0_CTL_R = 0;
+    TIMER0_IMR_R = 0;
+    NVIC_DIS0_R = 1 << TIMER0A_IRQ;
+}
+
+static
+void * task_malloc(isr_mode mode, size_t size)
+{
+    if (mode != MODE_LOCKED)
+        return malloc(size);
+    long sr = StartCritical();
+    void * ptr = malloc(size);
+    EndCritical(sr);
+    return ptr;
+}
+
+static
+void task_free(isr_mode mode, void * ptr)
+{
+    if (mode != MODE_LOCKED) {
+        free(ptr);
+        return;
+    }
+    long sr = StartCritical();
+    free(ptr);
+    EndCritical(sr);
+}
+
+// one step of the task: handle a received message, send a reply now and
+// then, and churn the heap with a random malloc or free
+static
+void task_step(isr_mode mode)
+{
+    uint32_t r = Random() >> 8;
+
+    void * msg = ring_get(&rx);
+    if (msg != NULL)
+        task_free(mode, msg);
+
+    if ((r & 3) == 0) {
+        void * reply = task_malloc(mode, 16 + (r >> 2) % 112);
+        if (reply != NULL && !ring_put(&tx, reply))
+            task_free(mode, reply);
+    }
+
+    uint32_t idx = (r >> 9) % ISR_SLOTS;
+    if (slots[idx] == NULL) {
+        slots[idx] = task_malloc(mode, 8 + (r >> 15) % 249);
+    } else {
+        task_free(mode, slots[idx]);
+        slots[idx] = NULL;
+    }
+}
+
+// the pool goes first: malloc_reset would drop it again
+static
+int run(isr_mode mode, uint32_t count, uint32_t pool_blocks)
+{
+    malloc_reset();
+    if (malloc_isr_pool(ISR_MSG_SIZE, pool_blocks))
+        return 1;
+    memset(&rx, 0, sizeof(rx));
+    memset(&tx, 0, sizeof(tx));
+    memset(slots, 0, sizeof(slots));
+    latency_reset(&entry_lat);
+    latency_reset(&handler_lat);
+    irqs = 0;
+
+    timer_start();
+    while (irqs < count) {
+        if (mode != MODE_IDLE)
+            task_step(mode);
+    }
+    timer_stop();
+    return 0;
+}
+
+// after the stats are taken, so these frees aren't counted
+static
+void release(void)
+{
+    void * ptr;
+    while ((ptr = ring_get(&rx)) != NULL) {
+        free(ptr);
+    }
+    while ((ptr = ring_get(&tx)) != NULL) {
+        free(ptr);
+    }
+    for (uint32_t i = 0; i < ISR_SLOTS; ++i) {
+        if (slots[i] != NULL)
+            free(slots[i]);
+    }
+}
+
+void benchmark_isr(uint32_t count, uint32_t timer_period, uint32_t pool_blocks)
+{
+    period = timer_period;
+    Random_Init(0xDEADBEEF);
+
+    printf("%-6s | %6s %6s %6s %6s | %7s %6s | %6s %5s %8s\n",
+           "task", "lat min", "mean", "p99", "max",
+           "handler", "max", "isr ok", "fail", "t malloc");
+    for (uint32_t m = MODE_IDLE; m <= MODE_LOCKED; ++m) {
+        if (run((isr_mode) m, count, pool_blocks)) {
+            printf("The heap can't hold %d pool blocks\n", pool_blocks);
+            return;
+        }
+        isr_pool_stats pool = malloc_isr_pool_stats();
+        heap_stats stats = malloc_stats();
+        printf("%-6s | %6d %6d %6d %6d | %7d %6d | %6d %5d %8d\n", mode_names[m],
+               entry_lat.min, latency_mean(&entry_lat),
+               latency_percentile(&entry_lat, 99), entry_lat.max,
+               latency_mean(&handler_lat), handler_lat.max,
+               pool.allocs, pool.fails,
+               (stats.malloc.sn > 0) ? (uint32_t) (stats.malloc.st / stats.malloc.sn) : 0);
+        release();
+    }
+    malloc_reset();
+    puts("(cycles; lat is timer timeout to handler entry, handler the time it spends");
+    puts(" in malloc and free, t malloc the task's mean malloc)");
+}
@@ -0,0 +1,244 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <malloc.h>
+#include <Random.h>
+#include <tm4c1294ncpdt.h>
+
+#include "benchmarks.h"
+
+// Larson-style server workload on simulated tasks. Every task keeps a table
+// of live objects; at each turn a random task replaces one of them with a
+// new object, and now and then hands the new object to another task, so
+// many objects are freed by a task other than the one that allocated them.
+// There is one core and no threads here, so tasks take turns at random like
+// in bench_rtos.c, and the two ways of sharing an allocator are compared:
+//   shared: one heap for all tasks, every call in a critical section
+//           standing in for a global lock
+//   arenas: a heap per task carved out of the default heap; freeing
+//           another task's object pushes it onto the owner's lock-free
+//           remote-free list, which the owner empties at its next malloc
+// Every call is timed from outside with Timer 1, lock included, since the
+// allocator's own SysTick window starts after the lock is taken.
+
+#define LARSON_SLOTS 32
+#define HANDOFF_ODDS 4      // 1 in 4 new objects go to another task
+#define ARENA_SLACK 64      // bytes per arena left for the default heap's overhead
+
+// startup.s
+long StartCritical(void);
+void EndCritical(long sr);
+
+typedef struct _object
+{
+    void * ptr;
+    uint8_t owner;          // task whose arena the object came from
+} object;
+
+static object objects[LARSON_MAX_TASKS][LARSON_SLOTS];
+static heap_instance * arenas[LARSON_MAX_TASKS];
+static void * arena_mem[LARSON_MAX_TASKS];
+
+typedef struct _larson_result
+{
+    uint32_t ops;
+    uint32_t failed;
+    uint32_t remote_frees;
+    uint32_t worst;         // slowest single call, e.g. a malloc with a long drain
+    uint64_t cycles;        // over all calls, locks and drains included
+} larson_result;
+
+static
+uint32_t rand(void)
+{
+    return Random() >> 8;
+}
+
+// free running 32 bit down counter; differences wrap correctly
+static
+void timer_start(void)
+{
+    SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R1;
+    while ((SYSCTL_PRTIMER_R & SYSCTL_PRTIMER_R1) == 0);
+    TIMER1_CTL_R = 0;                       // disable during setup
+    TIMER1_CFG_R = TIMER_CFG_32_BIT_TIMER;
+    TIMER1_TAMR_R = TIMER_TAMR_TAMR_PERIOD;
+    TIMER1_TAILR_R = 0xFFFFFFFF;
+    TIMER1_CTL_R = TIMER_CTL_TAEN;
+}
+
+static
+void timer_stop(void)
+{
+    TIMER1_CTL_R = 0;
+}
+
+static
+void add_op(larson_result * res, uint32_t start)
+{
+    uint32_t cycles = start - TIMER1_TAR_R;
+    res->cycles += cycles;
+    if (cycles > res->worst)
+        res->worst = cycles;
+    ++res->ops;
+}
+
+static
+void shared_free(object * obj)
+{
+    long sr = StartCritical();
+    free(obj->ptr);
+    EndCritical(sr);
+}
+
+static
+void * shared_malloc(size_t size)
+{
+    long sr = StartCritical();
+    void * ptr = malloc(size);
+    EndCritical(sr);
+    return ptr;
+}
+
+// heap_free queues another task's object on its arena's remote list
+// and the owner frees it at its next heap_malloc
+static
+void arena_free(uint32_t task, object * obj, larson_result * res)
+{
+    if (obj->owner != task)
+        ++res->remote_frees;
+    heap_free(arenas[task], obj->ptr);
+}
+
+// the arenas' blocks are dropped along with them
+static
+void arenas_destroy(uint32_t tasks)
+{
+    for (uint32_t t = 0; t < tasks; ++t) {
+        heap_destroy(arenas[t]);
+        free(arena_mem[t]);
+    }
+}
+
+static
+int arenas_create(uint32_t tasks)
+{
+    size_t bytes = malloc_largest_free() / tasks;
+    bytes = (bytes > ARENA_SLACK) ? bytes - ARENA_SLACK : 0;
+    for (uint32_t t = 0; t < tasks; ++t) {
+        arena_mem[t] = malloc(bytes);
+        arenas[t] = (arena_mem[t] != NULL) ? heap_create(malloc_current_impl(), arena_mem[t], bytes) : NULL;
+        if (arenas[t] == NULL) {
+            if (arena_mem[t] != NULL)
+                free(arena_mem[t]);
+            arenas_destroy(t);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static
+void run(uint32_t seed, const size_dist * dist, uint32_t tasks, uint32_t turns,
+         int use_arenas, larson_result * res)
+{
+    memset(res, 0, sizeof(*res));
+    Random_Init(seed);
+    for (uint32_t t = 0; t < tasks; ++t) {
+        for (uint32_t i = 0; i < LARSON_SLOTS; ++i) {
+            objects[t][i].ptr = NULL;
+        }
+    }
+
+    for (uint32_t turn = 0; turn < turns; ++turn) {
+        uint32_t task = rand() % tasks;
+        uint32_t r = rand();
+        object * obj = &objects[task][r % LARSON_SLOTS];
+
+        if (obj->ptr != NULL) {
+            uint32_t start = TIMER1_TAR_R;
+            if (use_arenas)
+                arena_free(task, obj, res);
+            else
+                shared_free(obj);
+            add_op(res, start);
+            obj->ptr = NULL;
+        }
+
+        // room for the remote-free link, in both modes to keep them comparable
+        size_t size = dist->table[(r >> 6) & (DIST_TABLE_LEN - 1)];
+        if (size < sizeof(void *))
+            size = sizeof(void *);
+        uint32_t start = TIMER1_TAR_R;
+        void * ptr = use_arenas ? heap_malloc(arenas[task], size) : shared_malloc(size);
+        add_op(res, start);
+        if (ptr == NULL) {
+            ++res->failed;
+            continue;
+        }
+        obj->ptr = ptr;
+        obj->owner = task;
+
+        // hand the new object to another task in exchange for one of its own
+        if (tasks > 1 && (r >> 16) % HANDOFF_ODDS == 0) {
+            uint32_t other = (task + 1 + rand() % (tasks - 1)) % tasks;
+            object * swap = &objects[other][rand() % LARSON_SLOTS];
+            object tmp = *swap;
+            *swap = *obj;
+            *obj = tmp;
+        }
+    }
+}
+
+// untimed, between the runs
+static
+void shared_release(uint32_t tasks)
+{
+    for (uint32_t t = 0; t < tasks; ++t) {
+        for (uint32_t i = 0; i < LARSON_SLOTS; ++i) {
+            if (objects[t][i].ptr != NULL)
+                free(objects[t][i].ptr);
+        }
+    }
+}
+
+void benchmark_larson(uint32_t seed, const size_dist * dist, uint32_t max_tasks, uint32_t turns)
+{
+    larson_result shared, split;
+
+    if (max_tasks == 0 || max_tasks > LARSON_MAX_TASKS)
+        max_tasks = LARSON_MAX_TASKS;
+
+    printf("%5s | %8s %8s %6s %6s | %8s %8s %6s %6s %7s\n",
+           "tasks", "shared", "ops/Mcyc", "worst", "failed",
+           "arenas", "ops/Mcyc", "worst", "failed", "remote");
+    timer_start();
+    for (uint32_t tasks = 1; tasks <= max_tasks; ++tasks) {
+        malloc_reset();
+        run(seed, dist, tasks, turns, 0, &shared);
+        shared_release(tasks);
+
+        malloc_reset();
+        if (arenas_create(tasks)) {
+            printf("%5d | not enough memory for %d arenas\n", tasks, tasks);
+            break;
+        }
+        run(seed, dist, tasks, turns, 1, &split);
+        arenas_destroy(tasks);
+
+        printf("%5d | %8d %8d %6d %6d | %8d %8d %6d %6d %6d%%\n", tasks,
+               (uint32_t) (shared.cycles / shared.ops),
+               (uint32_t) ((uint64_t) shared.ops * 1000000 / shared.cycles),
+               shared.worst, shared.failed,
+               (uint32_t) (split.cycles / split.ops),
+               (uint32_t) ((uint64_t) split.ops * 1000000 / split.cycles),
+               split.worst, split.failed,
+               split.remote_frees * 100 / split.ops);
+    }
+    timer_stop();
+    puts("(shared/arenas columns are cycles per call, lock and drains included;");
+    puts(" worst is the slowest call, remote the share of ops that were frees");
+    puts(" of another task's object)");
+}
@@ -0,0 +1,44 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "benchmarks.h"
+
+void latency_reset(latency * lat)
+{
+    memset(lat, 0, sizeof(*lat));
+    lat->min = UINT32_MAX;
+}
+
+void latency_add(latency * lat, uint32_t cycles)
+{
+    uint32_t bucket = cycles / LATENCY_BUCKET_CYCLES;
+    if (bucket >= LATENCY_BUCKETS)
+        bucket = LATENCY_BUCKETS - 1;
+    ++lat->buckets[bucket];
+    ++lat->count;
+    lat->total += cycles;
+    if (cycles > lat->max)
+        lat->max = cycles;
+    if (cycles < lat->min)
+        lat->min = cycles;
+}
+
+// upper edge of the bucket holding the given percentile
+uint32_t latency_percentile(const latency * lat, uint32_t percent)
+{
+    uint32_t target = (uint32_t) ((uint64_t) lat->count * percent / 100);
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < LATENCY_BUCKETS - 1; ++i) {
+        seen += lat->buckets[i];
+        if (seen > target)
+            return (i + 1) * LATENCY_BUCKET_CYCLES;
+    }
+    return lat->max;
+}
+
+uint32_t latency_mean(const latency * lat)
+{
+    return (lat->count > 0) ? (uint32_t) (lat->total / lat->count) : 0;
+}
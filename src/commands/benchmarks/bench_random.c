@@ -6,6 +6,8 @@
 #include <malloc.h>
 #include <Random.h>
 
+#include "benchmarks.h"
+
 extern uint32_t M;
 static
 uint32_t rand(void)
@@ -39,19 +41,53 @@ uint32_t rand_get_state(void)
     return M;
 }
 
-#define PTRS 256
+#define PTRS BENCH_RANDOM_MAX_PTRS
+
+// slot bookkeeping, all O(1):
+// free_slots is a stack of unused indices into ptrs, live is a dense array
+// of used indices and live_pos maps a used index back to its place in live
+static void * ptrs[PTRS];
+static uint16_t free_slots[PTRS];
+static uint32_t num_free = 0;
+static uint16_t live[PTRS];
+static uint16_t live_pos[PTRS];
+static uint32_t num_live = 0;
 
 static
-uint32_t find_empty_ptr(void * ptrs[PTRS])
+void slots_init(uint32_t max_ptrs)
 {
-    for (uint32_t i = 0; i < PTRS; ++i) {
-        if (ptrs[i] == NULL)
-            return i;
+    // pushed in reverse so the lowest index is handed out first
+    num_free = 0;
+    for (uint32_t i = max_ptrs; i > 0; --i) {
+        ptrs[i - 1] = NULL;
+        free_slots[num_free++] = i - 1;
     }
-    return -1;
+    num_live = 0;
 }
 
-// assumption: there is at least one taken pointer
+static
+uint32_t take_slot(void)
+{
+    uint32_t idx = free_slots[--num_free];
+    live_pos[idx] = num_live;
+    live[num_live++] = idx;
+    return idx;
+}
+
+// swap-remove idx from the live array
+static
+void release_slot(uint32_t idx)
+{
+    uint32_t pos = live_pos[idx];
+    uint32_t last = live[--num_live];
+    live[pos] = last;
+    live_pos[last] = pos;
+    ptrs[idx] = NULL;
+    free_slots[num_free++] = idx;
+}
+
+// random victims come from their own stream so the size stream stays
+// independent of the free pattern
 static
 uint32_t find_taken_state = 0;
 
@@ -61,31 +97,114 @@ void set_find_taken_seed(uint32_t seed)
     find_taken_state = seed;
 }
 
+// assumption: there is at least one taken pointer
 static
-uint32_t find_taken_ptr(void * ptrs[PTRS])
+uint32_t find_taken_ptr(void)
 {
     uint32_t save_state = rand_get_state();
     rand_set_state(find_taken_state);
-    void * ptr = NULL;
-    uint32_t idx = 0;
-    while (ptr == NULL) {
-        idx = rand() % PTRS;
-        ptr = ptrs[idx];
-    }
+    uint32_t idx = live[rand() % num_live];
     find_taken_state = rand_get_state();
     rand_set_state(save_state);
     return idx;
 }
 
-void benchmark_random(uint32_t seed, uint32_t size_low, uint32_t size_high, uint32_t actions)
+// lifetime policies pick which live pointer is freed next
+// allocation order of the mortal pointers; FIFO frees the oldest,
+// LIFO and generational the youngest
+static uint16_t order[PTRS];
+static uint32_t order_head = 0;
+static uint32_t order_count = 0;
+static uint16_t sizes[PTRS];
+static uint32_t immortals = 0;
+
+#define IMMORTAL_ODDS 16    // 1 in IMMORTAL_ODDS objects lives forever
+
+static
+void order_push(uint32_t idx)
 {
+    order[(order_head + order_count) % PTRS] = idx;
+    ++order_count;
+}
+
+static
+uint32_t order_pop_oldest(void)
+{
+    uint32_t idx = order[order_head];
+    order_head = (order_head + 1) % PTRS;
+    --order_count;
+    return idx;
+}
+
+static
+uint32_t order_pop_youngest(void)
+{
+    --order_count;
+    return order[(order_head + order_count) % PTRS];
+}
+
+static
+void track_alloc(lifetime life, uint32_t idx, uint32_t size, uint32_t max_ptrs)
+{
+    sizes[idx] = size;
+    switch (life) {
+    case LIFE_FIFO:
+    case LIFE_LIFO:
+        order_push(idx);
+        break;
+    case LIFE_GENERATIONAL:
+        // never let the immortals take more than a quarter of the slots
+        if (rand() % IMMORTAL_ODDS == 0 && immortals < max_ptrs / 4) {
+            ++immortals;
+        } else {
+            order_push(idx);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// returns the index of the pointer to free, or -1 if nothing may be freed
+static
+uint32_t pick_victim(lifetime life)
+{
+    uint32_t a, b;
+
+    if (num_live == 0)
+        return -1;
+
+    switch (life) {
+    case LIFE_FIFO:
+        return order_pop_oldest();
+    case LIFE_LIFO:
+        return order_pop_youngest();
+    case LIFE_GENERATIONAL:
+        if (order_count == 0)
+            return -1;
+        return order_pop_youngest();
+    case LIFE_SIZED:
+        // of two random candidates the smaller dies, so big objects live longer
+        a = find_taken_ptr();
+        b = find_taken_ptr();
+        return (sizes[a] <= sizes[b]) ? a : b;
+    default:
+        return find_taken_ptr();
+    }
+}
+
+void benchmark_random(uint32_t seed, const size_dist * dist, lifetime life, uint32_t actions,
+                      uint32_t max_ptrs)
+{
+    if (max_ptrs == 0 || max_ptrs > PTRS)
+        max_ptrs = PTRS;
+
     rand_set_state(seed);
     set_find_taken_seed(~seed);
-    
-    static void * ptrs[PTRS];
-    for (int i = 0; i < PTRS; ++i) {
-        ptrs[i] = 0x0;
-    }
+    order_head = 0;
+    order_count = 0;
+    immortals = 0;
+    slots_init(max_ptrs);
         
     // allocate pseudo-random number of bytes
     uint32_t mallocs = 0;
@@ -93,28 +212,30 @@ void benchmark_random(uint32_t seed, uint32_t size_low, uint32_t size_high, uint
     for (int i=0; i < actions; ++i) {
         uint32_t r = rand() % 2;
         
-        if ((r == 0 || mallocs == frees) && mallocs - frees < PTRS) {
+        if ((r == 0 || mallocs == frees) && num_free > 0) {
             uint32_t tries = rand_range(1,16);
             // malloc if 0, or no allocations, or too many allocations
-            while (tries > 0 && mallocs - frees < PTRS) {
-                uint32_t ptr_idx = find_empty_ptr(ptrs);
-                uint32_t size = rand_range(size_low, size_high);
-                size = (size > 0) ? size : 1;
+            while (tries > 0 && num_free > 0) {
+                uint32_t size = dist->table[rand() & (DIST_TABLE_LEN - 1)];
                 void * ptr = malloc(size);
                 
                 if (ptr != NULL) {
+                    uint32_t ptr_idx = take_slot();
                     ptrs[ptr_idx] = ptr;
+                    track_alloc(life, ptr_idx, size, max_ptrs);
                     ++mallocs;
                 }
                 tries--;
             }
         } else {
             uint32_t tries = rand_range(1,16);
-            while (tries > 0 && mallocs > frees) {
-                uint32_t ptr_idx = find_taken_ptr(ptrs);
+            while (tries > 0) {
+                uint32_t ptr_idx = pick_victim(life);
+                if (ptr_idx == -1)
+                    break;
                 void * ptr = ptrs[ptr_idx];
                 free(ptr);
-                ptrs[ptr_idx] = NULL;
+                release_slot(ptr_idx);
                 ++frees;
 
                 tries--;
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <malloc.h>
+#include <Random.h>
+
+#include "benchmarks.h"
+
+#define MAX_BUFFERS 32
+#define START_CAPACITY 16
+#define NOISE_SLOTS 4
+#define NOISE_SIZE 24
+
+typedef struct _buffer
+{
+    uint8_t * data;
+    uint32_t capacity;
+    uint32_t length;
+    int failed;
+} buffer;
+
+static
+uint32_t next_capacity(growth policy, uint32_t capacity, uint32_t needed, uint32_t step)
+{
+    uint32_t next;
+    switch (policy) {
+    case GROW_EXACT:
+        return needed;
+    case GROW_ADD:
+        next = capacity + step;
+        break;
+    case GROW_1_5X:
+        next = capacity + capacity / 2;
+        break;
+    default:
+        next = capacity * 2;
+        break;
+    }
+    return (next >= needed) ? next : needed;
+}
+
+void benchmark_realloc(growth policy, uint32_t buffers, uint32_t max_size, uint32_t step)
+{
+    static buffer bufs[MAX_BUFFERS];
+    void * noise[NOISE_SLOTS] = {NULL};
+    uint32_t noise_idx = 0;
+
+    uint32_t in_place = 0;
+    uint32_t moved = 0;
+    uint32_t failed = 0;
+
+    if (buffers > MAX_BUFFERS)
+        buffers = MAX_BUFFERS;
+    Random_Init(0xDEADBEEF);
+
+    for (uint32_t i = 0; i < buffers; ++i) {
+        bufs[i].data = malloc(START_CAPACITY);
+        bufs[i].capacity = START_CAPACITY;
+        bufs[i].length = 0;
+        bufs[i].failed = (bufs[i].data == NULL);
+    }
+
+    // append to the buffers round robin, with an unrelated allocation
+    // between appends so neighbours of a growing buffer aren't always free
+    uint32_t growing = buffers;
+    while (growing > 0) {
+        growing = 0;
+        for (uint32_t i = 0; i < buffers; ++i) {
+            buffer * b = &bufs[i];
+            if (b->failed || b->length >= max_size)
+                continue;
+            ++growing;
+
+            uint32_t chunk = (Random() >> 8) % 16 + 1;
+            uint32_t needed = b->length + chunk;
+            if (needed > b->capacity) {
+                uint32_t capacity = next_capacity(policy, b->capacity, needed, step);
+                uint8_t * data = realloc(b->data, capacity);
+                if (data == NULL) {
+                    b->failed = 1;
+                    ++failed;
+                    continue;
+                }
+                if (data == b->data)
+                    ++in_place;
+                else
+                    ++moved;
+                b->data = data;
+                b->capacity = capacity;
+            }
+            memset(&b->data[b->length], 'a' + i % 26, chunk);
+            b->length = needed;
+
+            if (noise[noise_idx] != NULL)
+                free(noise[noise_idx]);
+            noise[noise_idx] = malloc(NOISE_SIZE);
+            noise_idx = (noise_idx + 1) % NOISE_SLOTS;
+        }
+    }
+
+    for (uint32_t i = 0; i < NOISE_SLOTS; ++i) {
+        if (noise[i] != NULL)
+            free(noise[i]);
+    }
+    for (uint32_t i = 0; i < buffers; ++i) {
+        if (bufs[i].data != NULL)
+            free(bufs[i].data);
+    }
+
+    printf("Reallocs in place: %d, moved: %d, failed: %d\n", in_place, moved, failed);
+}
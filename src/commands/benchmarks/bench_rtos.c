@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <malloc.h>
+#include <Random.h>
+
+#include "benchmarks.h"
+
+// Message passing between simulated RTOS tasks. Producer tasks allocate
+// frames and post them to a consumer's FIFO; consumers handle any of the
+// first few queued messages, so buffers are freed out of allocation order.
+// A random task runs at every tick, standing in for the scheduler.
+
+#define MAX_PRODUCERS 8
+#define MAX_CONSUMERS 4
+#define FIFO_DEPTH 16
+#define OUT_OF_ORDER 4      // consumers pick among this many queued messages
+
+typedef struct _message
+{
+    uint8_t * data;
+    uint16_t size;
+} message;
+
+typedef struct _fifo
+{
+    message msgs[FIFO_DEPTH];
+    uint32_t head;
+    uint32_t count;
+} fifo;
+
+// protocol frame sizes with relative frequencies: CAN, UART packets,
+// short and full Ethernet frames
+static const uint16_t frame_sizes[] = {16, 32, 64, 256, 1518};
+static const uint8_t frame_weights[] = {8, 4, 2, 1, 1};
+#define FRAME_KINDS (sizeof(frame_sizes)/sizeof(frame_sizes[0]))
+
+static fifo fifos[MAX_CONSUMERS];
+static latency alloc_lat;
+static latency free_lat;
+
+static
+uint32_t rand(void)
+{
+    return Random() >> 8;
+}
+
+static
+uint16_t frame_size(void)
+{
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < FRAME_KINDS; ++i) {
+        total += frame_weights[i];
+    }
+    uint32_t pick = rand() % total;
+    for (uint32_t i = 0; i < FRAME_KINDS; ++i) {
+        if (pick < frame_weights[i])
+            return frame_sizes[i];
+        pick -= frame_weights[i];
+    }
+    return frame_sizes[0];
+}
+
+static
+message * fifo_at(fifo * f, uint32_t i)
+{
+    return &f->msgs[(f->head + i) % FIFO_DEPTH];
+}
+
+static
+void consume(fifo * f)
+{
+    uint32_t window = (f->count < OUT_OF_ORDER) ? f->count : OUT_OF_ORDER;
+    uint32_t pick = rand() % window;
+
+    // handle the picked message, then close the gap toward the head
+    message msg = *fifo_at(f, pick);
+    for (uint32_t i = pick; i > 0; --i) {
+        *fifo_at(f, i) = *fifo_at(f, i - 1);
+    }
+    f->head = (f->head + 1) % FIFO_DEPTH;
+    --f->count;
+
+    free(msg.data);
+    latency_add(&free_lat, malloc_last_cycles());
+}
+
+void benchmark_rtos(uint32_t seed, uint32_t producers, uint32_t consumers, uint32_t messages)
+{
+    uint32_t sent = 0;
+    uint32_t dropped = 0;
+    uint32_t failed = 0;
+
+    if (producers == 0 || producers > MAX_PRODUCERS)
+        producers = MAX_PRODUCERS;
+    if (consumers == 0 || consumers > MAX_CONSUMERS)
+        consumers = MAX_CONSUMERS;
+
+    Random_Init(seed);
+    memset(fifos, 0, sizeof(fifos));
+    latency_reset(&alloc_lat);
+    latency_reset(&free_lat);
+
+    while (sent + failed < messages) {
+        uint32_t task = rand() % (producers + consumers);
+        if (task < producers) {
+            uint16_t size = frame_size();
+            uint8_t * data = malloc(size);
+            latency_add(&alloc_lat, malloc_last_cycles());
+            if (data == NULL) {
+                ++failed;
+                continue;
+            }
+            data[0] = task;     // header: source task
+
+            fifo * f = &fifos[rand() % consumers];
+            if (f->count == FIFO_DEPTH) {
+                // mailbox full: the producer drops its frame
+                free(data);
+                ++dropped;
+            } else {
+                message * msg = fifo_at(f, f->count);
+                msg->data = data;
+                msg->size = size;
+                ++f->count;
+            }
+            ++sent;
+        } else {
+            fifo * f = &fifos[task - producers];
+            if (f->count > 0)
+                consume(f);
+        }
+    }
+
+    // drain the mailboxes
+    for (uint32_t c = 0; c < consumers; ++c) {
+        while (fifos[c].count > 0) {
+            consume(&fifos[c]);
+        }
+    }
+
+    printf("Sent %d messages, %d dropped on full FIFOs, %d allocations failed\n", sent, dropped, failed);
+    printf("Allocation latency: min %d, mean %d, p99 %d, max %d cycles\n",
+           alloc_lat.min, latency_mean(&alloc_lat), latency_percentile(&alloc_lat, 99), alloc_lat.max);
+    printf("Allocation jitter (max - min): %d cycles\n", alloc_lat.max - alloc_lat.min);
+    printf("Free latency: mean %d, max %d cycles\n", latency_mean(&free_lat), free_lat.max);
+}
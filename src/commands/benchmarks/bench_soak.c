@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <malloc.h>
+#include <Random.h>
+
+#include "benchmarks.h"
+
+// Long running mixed workload. Every op picks a random slot: an empty
+// slot gets a malloc, a full one is freed or (1 in 8) realloc'd. Latency
+// percentiles and fragmentation are reported per window of ops, so drift
+// as the heap ages shows up as a trend down the table.
+
+#define SOAK_SLOTS 512
+#define REALLOC_ODDS 8
+
+static void * slots[SOAK_SLOTS];
+static uint16_t slot_sizes[SOAK_SLOTS];
+static latency malloc_lat;
+static latency free_lat;
+
+void benchmark_soak(uint32_t seed, const size_dist * dist, uint32_t ops, uint32_t window)
+{
+    uint32_t live_bytes = 0;
+    uint32_t fails = 0;
+
+    Random_Init(seed);
+    for (uint32_t i = 0; i < SOAK_SLOTS; ++i) {
+        slots[i] = NULL;
+    }
+    latency_reset(&malloc_lat);
+    latency_reset(&free_lat);
+
+    printf("%8s | %6s %6s %6s %6s | %6s %6s | %5s %6s %6s %4s\n",
+           "ops", "m p50", "m p90", "m p99", "m max", "f p99", "f max",
+           "fails", "live", "lfree", "frag");
+    for (uint32_t op = 1; op <= ops; ++op) {
+        uint32_t r = Random() >> 8;
+        uint32_t idx = r % SOAK_SLOTS;
+        if (slots[idx] == NULL) {
+            uint32_t size = dist->table[(r >> 9) & (DIST_TABLE_LEN - 1)];
+            slots[idx] = malloc(size);
+            latency_add(&malloc_lat, malloc_last_cycles());
+            if (slots[idx] != NULL) {
+                slot_sizes[idx] = size;
+                live_bytes += size;
+            } else {
+                ++fails;
+            }
+        } else if ((r >> 9) % REALLOC_ODDS == 0) {
+            uint32_t size = dist->table[(r >> 12) & (DIST_TABLE_LEN - 1)];
+            void * ptr = realloc(slots[idx], size);
+            if (ptr != NULL) {
+                live_bytes += size - slot_sizes[idx];
+                slots[idx] = ptr;
+                slot_sizes[idx] = size;
+            } else {
+                ++fails;
+            }
+        } else {
+            free(slots[idx]);
+            latency_add(&free_lat, malloc_last_cycles());
+            live_bytes -= slot_sizes[idx];
+            slots[idx] = NULL;
+        }
+
+        if (op % window == 0 || op == ops) {
+            // fragmentation: share of the free memory not usable by one request
+            uint32_t largest = malloc_largest_free();
+            uint32_t free_bytes = malloc_heap_size() - live_bytes;
+            uint32_t frag = 100 - (uint32_t) ((uint64_t) largest * 100 / free_bytes);
+            printf("%8d | %6d %6d %6d %6d | %6d %6d | %5d %6d %6d %3d%%\n",
+                   op,
+                   latency_percentile(&malloc_lat, 50),
+                   latency_percentile(&malloc_lat, 90),
+                   latency_percentile(&malloc_lat, 99),
+                   malloc_lat.max,
+                   latency_percentile(&free_lat, 99),
+                   free_lat.max,
+                   fails, live_bytes, largest, frag);
+            latency_reset(&malloc_lat);
+            latency_reset(&free_lat);
+            fails = 0;
+        }
+    }
+
+    for (uint32_t i = 0; i < SOAK_SLOTS; ++i) {
+        if (slots[i] != NULL)
+            free(slots[i]);
+    }
+}
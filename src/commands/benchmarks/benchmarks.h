@@ -1,10 +1,84 @@
 #ifndef BENCHMARKS_H
 #define BENCHMARKS_H
 
-void benchmark_random(uint32_t seed, uint32_t size_low, uint32_t size_high, uint32_t actions);
+#define BENCH_RANDOM_PTRS 256          // default live pointer limit
+#define BENCH_RANDOM_MAX_PTRS 4096     // must fit in a uint16_t index
+
+// precomputed allocation size distribution, see bench_dist.c
+#define DIST_TABLE_LEN 1024     // must be a power of 2
+#define DIST_MAX_SIZE 0xFFFF
+typedef struct _size_dist
+{
+    const char * name;
+    uint16_t table[DIST_TABLE_LEN];
+} size_dist;
+
+void dist_uniform(size_dist * dist, uint32_t lo, uint32_t hi);
+void dist_exponential(size_dist * dist, uint32_t seed, uint32_t mean);
+void dist_lognormal(size_dist * dist, uint32_t seed, uint32_t median, float sigma);
+void dist_bimodal(size_dist * dist, uint32_t seed, uint32_t small, uint32_t large, uint32_t percent_small);
+void dist_zipf(size_dist * dist, float s);
+int dist_histogram(size_dist * dist, const uint16_t * sizes, const uint32_t * counts, uint32_t n);
+int dist_load_trace(const uint16_t * sizes, const uint32_t * counts, uint32_t n);
+const size_dist * dist_trace(void);
+void dist_print(const size_dist * dist);
+
+// which live object the random benchmark frees next
+typedef enum _lifetime
+{
+    LIFE_RANDOM,        // uniformly random, memoryless
+    LIFE_FIFO,          // oldest first (queue)
+    LIFE_LIFO,          // youngest first (stack)
+    LIFE_GENERATIONAL,  // youngest first, a few objects never die
+    LIFE_SIZED          // smaller objects die sooner
+} lifetime;
+
+// latency histogram: LATENCY_BUCKET_CYCLES wide buckets, the last one
+// catches the rest; see bench_latency.c
+#define LATENCY_BUCKET_CYCLES 8
+#define LATENCY_BUCKETS 512
+
+typedef struct _latency
+{
+    uint32_t buckets[LATENCY_BUCKETS];
+    uint32_t count;
+    uint64_t total;
+    uint32_t min;
+    uint32_t max;
+} latency;
+
+void latency_reset(latency * lat);
+void latency_add(latency * lat, uint32_t cycles);
+uint32_t latency_percentile(const latency * lat, uint32_t percent);
+uint32_t latency_mean(const latency * lat);
+
+// max_ptrs caps the number of live allocations (0 or > BENCH_RANDOM_MAX_PTRS for the max)
+void benchmark_random(uint32_t seed, const size_dist * dist, lifetime life, uint32_t actions,
+                      uint32_t max_ptrs);
+// how the realloc benchmark grows a full buffer
+typedef enum _growth
+{
+    GROW_EXACT,     // just enough for the append, like a naive string builder
+    GROW_ADD,       // a fixed step
+    GROW_1_5X,
+    GROW_2X
+} growth;
+
+void benchmark_realloc(growth policy, uint32_t buffers, uint32_t max_size, uint32_t step);
+void benchmark_frag(uint32_t small, uint32_t large);
+void benchmark_soak(uint32_t seed, const size_dist * dist, uint32_t ops, uint32_t window);
+void benchmark_align(uint32_t count, uint32_t lo, uint32_t hi);
+void benchmark_rtos(uint32_t seed, uint32_t producers, uint32_t consumers, uint32_t messages);
+// tasks of the larson benchmark; each needs a heap of its own
+#define LARSON_MAX_TASKS (MALLOC_MAX_HEAPS - 1)
+void benchmark_larson(uint32_t seed, const size_dist * dist, uint32_t max_tasks, uint32_t turns);
+void benchmark_isr(uint32_t count, uint32_t timer_period, uint32_t pool_blocks);
 void benchmark_vector(uint32_t actions);
 void benchmark_fixed(uint32_t size, uint32_t actions);
+void benchmark_fixed_sized(uint32_t size, uint32_t actions);
+void benchmark_fixed_batch(uint32_t size, uint32_t actions);
 void benchmark_tokenize(void);
+void benchmark_tokenize_batch(void);
 void benchmark_tokenize_bst(void);
 
 #endif
\ No newline at end of file
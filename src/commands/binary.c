@@ -0,0 +1,363 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <malloc.h>
+#include <UART.h>
+
+#include "benchmarks/benchmarks.h"
+
+// Framed binary protocol for host tools
+//
+// Every record, in either direction, is:
+//     SOF (0xA5) | len (u16) | op (u8) | payload (len - 1 bytes) | crc (u16)
+// Multi-byte fields are little endian. len counts the op byte plus the
+// payload. crc is CRC-16/CCITT (poly 0x1021, init 0xFFFF) over len, op and
+// payload. Replies carry (op | 0x80) and start with a status byte.
+// printf output is muted while in binary mode so it can't corrupt frames.
+
+#define SOF 0xA5
+#define MAX_PAYLOAD 256
+#define REPLY 0x80
+#define MAX_ARGS 16
+
+#define OP_PING     0x01    // echoes the payload back
+#define OP_SET_IMPL 0x02    // u8 heap_impl
+#define OP_RESET    0x03    // reinitializes the heap
+#define OP_STATS    0x04    // replies with the heap_stats record
+#define OP_BENCH    0x05    // NUL separated benchmark argv, replies with stats
+#define OP_READ_MEM 0x06    // u32 offset, u16 length: dumps heap_mem
+#define OP_LOAD_HIST 0x07   // u8 first, then (u16 size, u32 count) bins
+#define OP_SET_HEAP 0x08    // u32 offset, u32 size: heap region within heap_mem
+#define OP_HEAP_MAP 0x09    // u32 bytes per cell: one state byte per cell of heap_mem
+#define OP_EXIT     0x7F    // back to the text shell
+
+#define STATUS_OK       0
+#define STATUS_BAD_CRC  1
+#define STATUS_BAD_OP   2
+#define STATUS_BAD_ARG  3
+#define STATUS_FAILED   4
+
+int cmd_benchmark(int argc, char ** argv);
+int heap_map(uint32_t bytes_per_cell, const uint8_t ** map);
+
+static
+uint16_t crc16(uint16_t crc, uint8_t byte)
+{
+    crc ^= (uint16_t) byte << 8;
+    for (int i = 0; i < 8; ++i) {
+        if (crc & 0x8000)
+            crc = (crc << 1) ^ 0x1021;
+        else
+            crc <<= 1;
+    }
+    return crc;
+}
+
+// reply streaming: header, body pieces, then the crc
+static uint16_t tx_crc;
+
+static
+void tx_byte(uint8_t byte)
+{
+    tx_crc = crc16(tx_crc, byte);
+    UART_OutChar(byte);
+}
+
+static
+void tx_bytes(const void * data, uint32_t len)
+{
+    const uint8_t * bytes = (const uint8_t *) data;
+    for (uint32_t i = 0; i < len; ++i) {
+        tx_byte(bytes[i]);
+    }
+}
+
+static
+void tx_u32(uint32_t val)
+{
+    tx_byte(val);
+    tx_byte(val >> 8);
+    tx_byte(val >> 16);
+    tx_byte(val >> 24);
+}
+
+static
+void tx_u64(uint64_t val)
+{
+    tx_u32((uint32_t) val);
+    tx_u32((uint32_t) (val >> 32));
+}
+
+static
+void tx_begin(uint8_t op, uint8_t status, uint16_t body_len)
+{
+    uint16_t len = body_len + 2;    // op and status
+    UART_OutChar(SOF);
+    tx_crc = 0xFFFF;
+    tx_byte(len);
+    tx_byte(len >> 8);
+    tx_byte(op | REPLY);
+    tx_byte(status);
+}
+
+static
+void tx_end(void)
+{
+    uint16_t crc = tx_crc;
+    UART_OutChar(crc);
+    UART_OutChar(crc >> 8);
+}
+
+static
+void tx_status(uint8_t op, uint8_t status)
+{
+    tx_begin(op, status, 0);
+    tx_end();
+}
+
+static
+uint8_t rx_byte(void)
+{
+    return (uint8_t) UART_InChar();
+}
+
+static
+uint32_t get_u32(const uint8_t * p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+// receives one frame into payload; returns the op, or -1 on a bad crc
+static
+int rx_frame(uint8_t * payload, uint16_t * payload_len)
+{
+    uint16_t crc = 0xFFFF;
+    uint16_t len;
+    uint8_t op;
+    uint8_t byte;
+
+    // resynchronize on the start of frame
+    while (rx_byte() != SOF);
+
+    byte = rx_byte(); crc = crc16(crc, byte); len = byte;
+    byte = rx_byte(); crc = crc16(crc, byte); len |= byte << 8;
+    if (len == 0 || len > MAX_PAYLOAD + 1)
+        return -1;
+
+    op = rx_byte(); crc = crc16(crc, op);
+    *payload_len = len - 1;
+    for (uint16_t i = 0; i < *payload_len; ++i) {
+        payload[i] = rx_byte();
+        crc = crc16(crc, payload[i]);
+    }
+
+    uint16_t rx_crc = rx_byte();
+    rx_crc |= rx_byte() << 8;
+    if (rx_crc != crc)
+        return -1;
+    return op;
+}
+
+static
+void tx_stats(uint8_t op)
+{
+    heap_stats stats = malloc_stats();
+    const heap_stat * stat[] = {&stats.malloc, &stats.calloc, &stats.free, &stats.realloc, &stats.memalign};
+
+    // st and ft are u64, sn and fn are u32
+    tx_begin(op, STATUS_OK, sizeof(stat) / sizeof(stat[0]) * 24);
+    for (int i = 0; i < sizeof(stat) / sizeof(stat[0]); ++i) {
+        tx_u64(stat[i]->st);
+        tx_u32(stat[i]->sn);
+        tx_u64(stat[i]->ft);
+        tx_u32(stat[i]->fn);
+    }
+    tx_end();
+}
+
+static
+void op_bench(uint8_t op, uint8_t * payload, uint16_t len)
+{
+    char * argv[MAX_ARGS];
+    int argc = 0;
+
+    // argv[0] is the "bench" command itself
+    argv[argc++] = "bench";
+    payload[len] = '\0';
+    for (uint16_t i = 0; i < len && argc < MAX_ARGS; ) {
+        argv[argc++] = (char *) &payload[i];
+        i += strlen((char *) &payload[i]) + 1;
+    }
+
+    if (cmd_benchmark(argc, argv) != 0) {
+        tx_status(op, STATUS_FAILED);
+        return;
+    }
+    tx_stats(op);
+}
+
+static
+void op_read_mem(uint8_t op, const uint8_t * payload, uint16_t len)
+{
+    if (len < 6) {
+        tx_status(op, STATUS_BAD_ARG);
+        return;
+    }
+
+    uint32_t offset = get_u32(payload);
+    uint32_t count = payload[4] | (payload[5] << 8);
+    if (offset > MALLOC_SIZE || count > MALLOC_SIZE - offset || count > 0xFFFD) {
+        tx_status(op, STATUS_BAD_ARG);
+        return;
+    }
+
+    tx_begin(op, STATUS_OK, count);
+    tx_bytes(&heap_mem[offset], count);
+    tx_end();
+}
+
+// size histogram from a host trace; may span several frames
+#define MAX_BINS 256
+static uint16_t hist_sizes[MAX_BINS];
+static uint32_t hist_counts[MAX_BINS];
+static uint32_t hist_bins = 0;
+
+static
+void op_load_hist(uint8_t op, const uint8_t * payload, uint16_t len)
+{
+    if (len < 1) {
+        tx_status(op, STATUS_BAD_ARG);
+        return;
+    }
+
+    // a set first flag starts a new histogram, otherwise bins are appended
+    if (payload[0])
+        hist_bins = 0;
+    uint16_t i = 1;
+    for (; i + 6 <= len && hist_bins < MAX_BINS; i += 6) {
+        hist_sizes[hist_bins] = payload[i] | (payload[i + 1] << 8);
+        hist_counts[hist_bins] = get_u32(&payload[i + 2]);
+        ++hist_bins;
+    }
+    // more than MAX_BINS: the trace is left as it was rather than truncated
+    if (i + 6 <= len) {
+        tx_status(op, STATUS_BAD_ARG);
+        return;
+    }
+
+    if (dist_load_trace(hist_sizes, hist_counts, hist_bins)) {
+        tx_status(op, STATUS_BAD_ARG);
+        return;
+    }
+    tx_status(op, STATUS_OK);
+}
+
+static
+void op_set_heap(uint8_t op, const uint8_t * payload, uint16_t len)
+{
+    if (len < 8) {
+        tx_status(op, STATUS_BAD_ARG);
+        return;
+    }
+
+    uint32_t offset = get_u32(payload);
+    uint32_t size = get_u32(&payload[4]);
+    if (size == 0 || offset > MALLOC_SIZE || size > MALLOC_SIZE - offset) {
+        tx_status(op, STATUS_BAD_ARG);
+        return;
+    }
+    if (malloc_init_region(malloc_current_impl(), &heap_mem[offset], size)) {
+        tx_status(op, STATUS_BAD_ARG);
+        return;
+    }
+    tx_status(op, STATUS_OK);
+}
+
+// cell states are 0 not heap, 1 metadata, 2 free, 3 used; a host tool
+// can turn successive maps into an image series
+static
+void op_heap_map(uint8_t op, const uint8_t * payload, uint16_t len)
+{
+    if (len < 4) {
+        tx_status(op, STATUS_BAD_ARG);
+        return;
+    }
+
+    const uint8_t * map;
+    int n = heap_map(get_u32(payload), &map);
+    if (n == MALLOC_UNSUPPORTED) {
+        tx_status(op, STATUS_FAILED);
+        return;
+    } else if (n == 0) {
+        tx_status(op, STATUS_BAD_ARG);
+        return;
+    }
+    tx_begin(op, STATUS_OK, n);
+    tx_bytes(map, n);
+    tx_end();
+}
+
+int cmd_binary(int argc, char ** argv)
+{
+    // one extra byte so string payloads can always be terminated
+    static uint8_t payload[MAX_PAYLOAD + 1];
+    uint16_t len;
+    int run = 1;
+
+    puts("Entering binary mode");
+    UART_Mute(1);
+    while (run) {
+        int op = rx_frame(payload, &len);
+        switch (op) {
+        case -1:
+            tx_status(0, STATUS_BAD_CRC);
+            break;
+        case OP_PING:
+            tx_begin(op, STATUS_OK, len);
+            tx_bytes(payload, len);
+            tx_end();
+            break;
+        case OP_SET_IMPL:
+            if (len < 1 || payload[0] > IMPL_BRANDON_KNUTH) {
+                tx_status(op, STATUS_BAD_ARG);
+                break;
+            }
+            malloc_init((heap_impl) payload[0]);
+            tx_status(op, STATUS_OK);
+            break;
+        case OP_RESET:
+            malloc_reset();
+            tx_status(op, STATUS_OK);
+            break;
+        case OP_STATS:
+            tx_stats(op);
+            break;
+        case OP_BENCH:
+            op_bench(op, payload, len);
+            break;
+        case OP_READ_MEM:
+            op_read_mem(op, payload, len);
+            break;
+        case OP_LOAD_HIST:
+            op_load_hist(op, payload, len);
+            break;
+        case OP_SET_HEAP:
+            op_set_heap(op, payload, len);
+            break;
+        case OP_HEAP_MAP:
+            op_heap_map(op, payload, len);
+            break;
+        case OP_EXIT:
+            tx_status(op, STATUS_OK);
+            run = 0;
+            break;
+        default:
+            tx_status(op, STATUS_BAD_OP);
+            break;
+        }
+    }
+    UART_Mute(0);
+    puts("Left binary mode");
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <malloc.h>
+
+// addresses are return addresses into the caller; look them up in the
+// linker map or the disassembly to find the calling function
+static
+void print_callsites(uint32_t top)
+{
+    static callsite sites[MALLOC_CALLSITES];
+    uint32_t dropped = 0;
+    int n = malloc_callsites(sites, MALLOC_CALLSITES, &dropped);
+
+    if (n == 0) {
+        puts("No call sites recorded");
+        return;
+    }
+    printf("%10s %2s %8s %10s %12s %8s\n", "address", "op", "calls", "bytes", "cycles", "avg");
+    for (int i = 0; i < n && i < top; ++i) {
+        printf("0x%08X %2c %8d %10d %12u %8d\n",
+               sites[i].addr, sites[i].op, sites[i].count, sites[i].bytes,
+               (uint32_t) sites[i].cycles, (sites[i].count > 0) ? (uint32_t) (sites[i].cycles / sites[i].count) : 0);
+    }
+    if (dropped > 0)
+        printf("%d calls from sites that didn't fit in the table\n", dropped);
+}
+
+int cmd_callsites(int argc, char ** argv)
+{
+    uint32_t top = 10;
+    if (argc >= 2) {
+        if (strcmp("on", argv[1]) == 0) {
+            malloc_record_clear();
+            malloc_record(1);
+            puts("Recording call sites");
+            return 0;
+        } else if (strcmp("off", argv[1]) == 0) {
+            malloc_record(0);
+            puts("Stopped recording call sites");
+            return 0;
+        } else if (strcmp("clear", argv[1]) == 0) {
+            malloc_record_clear();
+            return 0;
+        }
+        sscanf(argv[1], "%d", &top);
+    }
+
+    print_callsites(top);
+    return 0;
+}
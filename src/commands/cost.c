@@ -0,0 +1,48 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <malloc.h>
+#include <cost_model.h>
+
+#define ARRAY_LEN(x) (sizeof(x)/sizeof(x[0]))
+
+typedef struct _cost_param
+{
+    const char * name;
+    uint32_t * value;
+} cost_param;
+
+static const cost_param params[] =
+{
+    {"call", &cost_model.call},
+    {"load", &cost_model.load},
+    {"store", &cost_model.store},
+    {"branch", &cost_model.branch},
+    {"flash-wait", &cost_model.flash_wait},
+    {"prefetch-hit", &cost_model.prefetch_hit},
+};
+
+int cmd_cost(int argc, char ** argv)
+{
+    if (argc >= 3) {
+        int i = 0;
+        while (i < ARRAY_LEN(params) && strcmp(params[i].name, argv[1]) != 0)
+            ++i;
+        if (i == ARRAY_LEN(params)) {
+            printf("Unrecognized parameter: \"%s\"\n", argv[1]);
+            return 1;
+        }
+        sscanf(argv[2], "%d", params[i].value);
+        if (cost_model.prefetch_hit > 100)
+            cost_model.prefetch_hit = 100;
+    }
+
+    printf("Cost model: %s\n", cost_model.name);
+    for (int i = 0; i < ARRAY_LEN(params); ++i) {
+        printf("    %-12s %d\n", params[i].name, *params[i].value);
+    }
+    if (!malloc_counts_accesses())
+        puts("The current allocator doesn't count accesses; build with HEAP_COUNT_ACCESSES for Valvano");
+    return 0;
+}
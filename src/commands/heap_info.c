@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <malloc.h>
+
+typedef struct _block_totals
+{
+    uint32_t used_blocks;
+    uint32_t used_bytes;
+    uint32_t free_blocks;
+    uint32_t free_bytes;
+} block_totals;
+
+static
+void count_block(void * ptr, size_t size, int used, void * ctx)
+{
+    block_totals * totals = (block_totals *) ctx;
+    if (used) {
+        ++totals->used_blocks;
+        totals->used_bytes += size;
+    } else {
+        ++totals->free_blocks;
+        totals->free_bytes += size;
+    }
+}
+
+int cmd_heap_info(int argc, char ** argv)
+{
+    block_totals totals = {0, 0, 0, 0};
+
+    int valid = malloc_validate();
+    if (valid == MALLOC_UNSUPPORTED)
+        printf("Heap check: not supported\n");
+    else
+        printf("Heap check: %s\n", (valid == 0) ? "ok" : "CORRUPTED");
+
+    if (!malloc_has_aligned_alloc())
+        printf("Aligned alloc: not supported\n");
+    if (!malloc_has_usable_size())
+        printf("Usable size: not supported\n");
+
+    size_t largest = malloc_largest_free();
+    printf("Largest free block: %d bytes\n", largest);
+
+    if (malloc_walk(count_block, &totals) == MALLOC_UNSUPPORTED) {
+        printf("Block walk: not supported\n");
+        return 0;
+    }
+    printf("Used: %d blocks, %d bytes\n", totals.used_blocks, totals.used_bytes);
+    printf("Free: %d blocks, %d bytes\n", totals.free_blocks, totals.free_bytes);
+    printf("Metadata: %d bytes\n", malloc_metadata_bytes());
+    if (totals.free_bytes > 0) {
+        printf("Fragmentation: %d%%\n", 100 - (uint32_t) ((uint64_t) largest * 100 / totals.free_bytes));
+    }
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <malloc.h>
+#include <UART.h>
+
+// Heap map: heap_mem split into cells of a fixed number of bytes, each
+// cell showing what most of its bytes are. Bytes inside a heap region
+// that no block covers are the allocator's metadata.
+
+#define MAP_MAX_CELLS 2048
+#define MAP_COLUMNS 64
+
+// cell states, also the byte values sent by the binary protocol
+#define CELL_OUTSIDE 0
+#define CELL_META 1
+#define CELL_FREE 2
+#define CELL_USED 3
+
+static uint16_t used_bytes[MAP_MAX_CELLS];
+static uint16_t free_bytes[MAP_MAX_CELLS];
+static uint16_t heap_bytes[MAP_MAX_CELLS];
+static uint8_t cells[MAP_MAX_CELLS];
+static uint32_t cell_bytes;
+
+// adds the bytes of [start, start + size) to each cell they fall in
+static
+void add_span(uint16_t * counts, uint32_t start, uint32_t size)
+{
+    uint32_t end = start + size;
+    if (end > MALLOC_SIZE)
+        end = MALLOC_SIZE;
+    while (start < end) {
+        uint32_t cell = start / cell_bytes;
+        uint32_t cell_end = (cell + 1) * cell_bytes;
+        uint32_t n = ((cell_end < end) ? cell_end : end) - start;
+        counts[cell] += n;
+        start += n;
+    }
+}
+
+static
+void map_block(void * ptr, size_t size, int used, void * ctx)
+{
+    add_span(used ? used_bytes : free_bytes, (uint8_t *) ptr - heap_mem, size);
+}
+
+// fills cells for the current heap; returns the number of cells, 0 if the
+// cell size is out of range or MALLOC_UNSUPPORTED if the allocator can't
+// be walked
+int heap_map(uint32_t bytes_per_cell, const uint8_t ** map)
+{
+    if (bytes_per_cell == 0 || bytes_per_cell > 0xFFFF ||
+        (MALLOC_SIZE + bytes_per_cell - 1) / bytes_per_cell > MAP_MAX_CELLS)
+        return 0;
+
+    cell_bytes = bytes_per_cell;
+    uint32_t n = (MALLOC_SIZE + cell_bytes - 1) / cell_bytes;
+    memset(used_bytes, 0, n * sizeof(used_bytes[0]));
+    memset(free_bytes, 0, n * sizeof(free_bytes[0]));
+    memset(heap_bytes, 0, n * sizeof(heap_bytes[0]));
+
+    if (malloc_walk(map_block, NULL) == MALLOC_UNSUPPORTED)
+        return MALLOC_UNSUPPORTED;
+    for (int r = 0; r < malloc_num_regions(); ++r) {
+        add_span(heap_bytes, (uint8_t *) malloc_region_base(r) - heap_mem, malloc_region_size(r));
+    }
+
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t meta = heap_bytes[i] - used_bytes[i] - free_bytes[i];
+        if (heap_bytes[i] == 0)
+            cells[i] = CELL_OUTSIDE;
+        else if (used_bytes[i] >= free_bytes[i] && used_bytes[i] >= meta)
+            cells[i] = CELL_USED;
+        else if (free_bytes[i] >= meta)
+            cells[i] = CELL_FREE;
+        else
+            cells[i] = CELL_META;
+    }
+    *map = cells;
+    return n;
+}
+
+static const char cell_chars[] = {' ', 'm', '.', '#'};
+// ANSI background colors: default, yellow, green, red
+static const char * cell_colors[] = {"\x1b[0m", "\x1b[43m", "\x1b[42m", "\x1b[41m"};
+
+// straight to the UART: fputc turns ESC into a line break
+static
+void out_color(uint8_t cell)
+{
+    for (const char * c = cell_colors[cell]; *c != '\0'; ++c) {
+        UART_OutChar(*c);
+    }
+}
+
+int cmd_heap_map(int argc, char ** argv)
+{
+    uint32_t bytes_per_cell = 64;
+    int color = 0;
+    if (argc >= 2) {
+        sscanf(argv[1], "%d", &bytes_per_cell);
+        if (argc >= 3) {
+            color = (strcmp("color", argv[2]) == 0);
+        }
+    }
+
+    const uint8_t * map;
+    int n = heap_map(bytes_per_cell, &map);
+    if (n == MALLOC_UNSUPPORTED) {
+        printf("Block walk: not supported\n");
+        return 1;
+    } else if (n == 0) {
+        printf("Cell size must be 1 to 65535 bytes and give at most %d cells\n", MAP_MAX_CELLS);
+        return 1;
+    }
+
+    printf("heap_mem, %dB per cell: '#' used, '.' free, 'm' metadata, ' ' not heap\n", bytes_per_cell);
+    for (int i = 0; i < n; i += MAP_COLUMNS) {
+        printf("%06X |", i * bytes_per_cell);
+        int shown = -1;
+        for (int j = i; j < n && j < i + MAP_COLUMNS; ++j) {
+            if (color) {
+                if (map[j] != shown) {
+                    out_color(map[j]);
+                    shown = map[j];
+                }
+                putchar(' ');
+            } else {
+                putchar(cell_chars[map[j]]);
+            }
+        }
+        if (color)
+            out_color(CELL_OUTSIDE);
+        puts("|");
+    }
+    return 0;
+}
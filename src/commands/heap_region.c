@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <malloc.h>
+
+int cmd_heap_size(int argc, char ** argv)
+{
+    if (argc < 2) {
+        printf("Heap: %d bytes at heap_mem + %d\n", malloc_region_size(0),
+               (uint8_t *) malloc_heap_base() - heap_mem);
+        return 0;
+    }
+
+    uint32_t size = 0;
+    uint32_t offset = 0;
+    sscanf(argv[1], "%d", &size);
+    if (argc >= 3) {
+        sscanf(argv[2], "%d", &offset);
+    }
+    if (size == 0 || offset > MALLOC_SIZE || size > MALLOC_SIZE - offset) {
+        printf("Heap must fit in heap_mem (%d bytes)\n", MALLOC_SIZE);
+        return 1;
+    }
+
+    if (malloc_init_region(malloc_current_impl(), &heap_mem[offset], size)) {
+        printf("The allocator can't use %d bytes, the heap is unchanged\n", size);
+        return 1;
+    }
+    printf("Heap set to %d bytes at heap_mem + %d. Heap and stats reset.\n", size, offset);
+    return 0;
+}
+
+// extra regions are carved from heap_mem too; leaving a gap between them
+// and the first region stands in for a second SRAM bank
+int cmd_heap_region(int argc, char ** argv)
+{
+    if (argc < 3) {
+        for (int i = 0; i < malloc_num_regions(); ++i) {
+            printf("Region %d: %d bytes at heap_mem + %d\n", i, malloc_region_size(i),
+                   (uint8_t *) malloc_region_base(i) - heap_mem);
+        }
+        printf("Total: %d bytes\n", malloc_heap_size());
+        return 0;
+    }
+
+    uint32_t size = 0;
+    uint32_t offset = 0;
+    sscanf(argv[1], "%d", &size);
+    sscanf(argv[2], "%d", &offset);
+    if (size == 0 || offset > MALLOC_SIZE || size > MALLOC_SIZE - offset) {
+        printf("Region must fit in heap_mem (%d bytes)\n", MALLOC_SIZE);
+        return 1;
+    }
+
+    int ret = malloc_add_region(&heap_mem[offset], size);
+    if (ret == MALLOC_UNSUPPORTED) {
+        puts("This allocator manages a single region");
+        return 1;
+    } else if (ret != 0) {
+        printf("Can't add the region: it overlaps the heap, is too small, or there are already %d regions\n",
+               MALLOC_MAX_REGIONS);
+        return 1;
+    }
+    printf("Added region %d: %d bytes at heap_mem + %d\n", malloc_num_regions() - 1, size, offset);
+    return 0;
+}
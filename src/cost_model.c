@@ -0,0 +1,28 @@
+#include <stdint.h>
+#include "cost_model.h"
+
+// Cortex-M4 TRM: LDR takes 2 cycles (1 when pipelined after another
+// load), STR 1, and a taken branch 1 plus a 1-3 cycle refill. The
+// TM4C1294 datasheet sets 5 flash wait states above 100 MHz; the
+// prefetch buffers hide them for straight line code but not always
+// for branch targets. call is a starting point to calibrate on a board
+// with a normal build.
+cost_model_t cost_model =
+{
+    .name = "TM4C1294 @ 120 MHz",
+    .call = 40,
+    .load = 2,
+    .store = 1,
+    .branch = 3,
+    .flash_wait = 5,
+    .prefetch_hit = 75
+};
+
+uint64_t cost_estimate(const cost_model_t * model, const heap_stat * stat)
+{
+    uint64_t calls = stat->sn + stat->fn;
+    // branch cost in hundredths of a cycle so the flash term stays exact
+    uint64_t branch = model->branch * 100 + model->flash_wait * (100 - model->prefetch_hit);
+    return calls * model->call + stat->loads * model->load + stat->stores * model->store
+           + stat->branches * branch / 100;
+}
@@ -32,17 +32,52 @@
 // If the block is used, the meta-sections record the room as a positive
 // number.  If the block is unused, the meta-sections record the room as a
 // negative number.
+// The heap may span several disjoint regions of memory.  Each region
+// starts and ends with a used sentinel block holding one word, so every
+// block has neighbours inside its own region and frees never coalesce
+// across regions.
 #include <stdint.h>
 #include "malloc.h"
 #include "heap.h"
 
-#define HEAP_START (int32_t *)(heap_mem)
-#define HEAP_END (HEAP_START + HEAP_SIZE_WORDS)
+// words in a sentinel block: header, one word of room, trailer
+#define SENTINEL_WORDS 3
 
-//The actual heap is just a big array.
+//The actual heap is just big arrays, by default all of heap_mem.
 //static int32_t Heap[HEAP_SIZE_WORDS];
+#ifdef HEAP_COUNT_ACCESSES
+// Every read and write of block metadata goes through LOAD and STORE so
+// an instrumented build can count them.  Lines are the distinct 32 byte
+// lines touched since Heap_AccessReset, as a cache would see them.
+// BRANCH counts loop iterations whose number depends on the heap or the
+// request; branches taken a fixed number of times per call are not counted.
+#define ACCESS_LINE_BYTES 32
+#define ACCESS_MAX_LINES 64   // further new lines are counted, not remembered
+static heap_access_t accesses;
+static uintptr_t linesSeen[ACCESS_MAX_LINES];
+static void countAccess(int32_t* address, int32_t store);
+#define LOAD(p) (countAccess((p), 0), *(p))
+#define STORE(p, v) (countAccess((p), 1), *(p) = (v))
+#define BRANCH() (accesses.branches++)
+#else
+#define LOAD(p) (*(p))
+#define STORE(p, v) (*(p) = (v))
+#define BRANCH()
+#endif
 
-static int32_t inHeapRange(int32_t* address);
+// the heap behind the plain Heap_ functions
+static heap_t defaultHeap = {
+  {{(int32_t*)heap_mem, (int32_t*)heap_mem + HEAP_SIZE_WORDS}}, 1
+};
+
+static int32_t alignRegion(heap_region_t* region, void* base, int32_t bytes);
+static void formatRegion(heap_region_t* region);
+static heap_region_t* regionOf(heap_t* heap, int32_t* address);
+static int32_t inRegion(heap_region_t* region, int32_t* address);
+static int32_t isSentinel(heap_region_t* region, int32_t* blockStart);
+static int32_t* firstFit(heap_region_t* region, int32_t desiredWords);
+static int32_t blockFreeable(heap_region_t* region, int32_t* blockStart);
+static void sortByAddress(void** blocks, int32_t count);
 static int32_t blockUsed(int32_t* block);
 static int32_t blockUnused(int32_t* block);
 static int32_t blockRoom(int32_t* block);
@@ -62,12 +97,65 @@ static void mergeBlockWithBelow(int32_t* upperBlockStart);
 // input: none
 // output: always HEAP_OK
 // notes: Initializes/resets the heap to a clean state where no memory
-//  is allocated.
+//  is allocated.  Uses all of heap_mem.
 int32_t Heap_Init(void){
-  int32_t* blockStart = HEAP_START;
-  int32_t* blockEnd = (HEAP_START + HEAP_SIZE_WORDS - 1);
-  *blockStart = -(int32_t)(HEAP_SIZE_WORDS - 2);  
-  *blockEnd = -(int32_t)(HEAP_SIZE_WORDS - 2);
+  return Heap_InitRegion(heap_mem, HEAP_SIZE_BYTES);
+}
+
+
+//******** Heap_InitRegion *************** 
+// Initialize the Heap in the given memory
+// input:
+//   base: start of the memory for the heap
+//   bytes: size of that memory in bytes
+// output: HEAP_OK, or HEAP_ERROR_BAD_REGION if the memory can't hold
+//   even one block
+// notes: base is rounded up and the end rounded down to whole words.
+//  Initializes/resets the heap to a clean state where no memory
+//  is allocated.  Any regions added by Heap_AddRegion are dropped;
+//  this memory becomes region 0.
+int32_t Heap_InitRegion(void* base, int32_t bytes){
+  return Heap_InitRegion_r(&defaultHeap, base, bytes);
+}
+int32_t Heap_InitRegion_r(heap_t* heap, void* base, int32_t bytes){
+  heap_region_t region;
+  if(alignRegion(&region, base, bytes)){
+    return HEAP_ERROR_BAD_REGION;
+  }
+  heap->regions[0] = region;
+  heap->numRegions = 1;
+  formatRegion(&heap->regions[0]);
+  return HEAP_OK;
+}
+
+
+//******** Heap_AddRegion *************** 
+// Add more memory to the Heap
+// input:
+//   base: start of the memory to add
+//   bytes: size of that memory in bytes
+// output: HEAP_OK, or HEAP_ERROR_BAD_REGION if the memory can't hold
+//   even one block, overlaps the heap or there are already
+//   HEAP_MAX_REGIONS regions
+// notes: the memory need not be next to the rest of the heap.  It
+//  becomes the next region number and starts out entirely unused.
+int32_t Heap_AddRegion(void* base, int32_t bytes){
+  return Heap_AddRegion_r(&defaultHeap, base, bytes);
+}
+int32_t Heap_AddRegion_r(heap_t* heap, void* base, int32_t bytes){
+  heap_region_t region;
+  int32_t i;
+  if(heap->numRegions >= HEAP_MAX_REGIONS || alignRegion(&region, base, bytes)){
+    return HEAP_ERROR_BAD_REGION;
+  }
+  for(i = 0; i < heap->numRegions; i++){
+    if(region.start < heap->regions[i].end && heap->regions[i].start < region.end){
+      return HEAP_ERROR_BAD_REGION;
+    }
+  }
+  heap->regions[heap->numRegions] = region;
+  formatRegion(&heap->regions[heap->numRegions]);
+  heap->numRegions++;
   return HEAP_OK;
 }
 
@@ -78,22 +166,147 @@ int32_t Heap_Init(void){
 //   desiredBytes: desired number of bytes to allocate
 // output: void* pointing to the allocated memory or will return NULL
 //   if there isn't sufficient space to satisfy allocation request
+// notes: regions are searched in the order they were added
 void* Heap_Malloc(int32_t desiredBytes){
+  return Heap_Malloc_r(&defaultHeap, desiredBytes);
+}
+void* Heap_Malloc_r(heap_t* heap, int32_t desiredBytes){
+  return Heap_MallocRegion_r(heap, desiredBytes, 0);
+}
+
+
+//******** Heap_MallocRegion *************** 
+// Allocate memory, preferably in the given region
+// input: 
+//   desiredBytes: desired number of bytes to allocate
+//   region: region number to try first, 0 for the Heap_InitRegion memory
+// output: void* pointing to the allocated memory or will return NULL
+//   if there isn't sufficient space in any region
+// notes: the hint is only a preference; if the region is full the other
+//   regions are searched in order.  An unknown region number acts as 0.
+void* Heap_MallocRegion(int32_t desiredBytes, int32_t region){
+  return Heap_MallocRegion_r(&defaultHeap, desiredBytes, region);
+}
+void* Heap_MallocRegion_r(heap_t* heap, int32_t desiredBytes, int32_t region){
   int32_t desiredWords = (desiredBytes + sizeof(int32_t) - 1) / sizeof(int32_t);
-  int32_t* blockStart = HEAP_START;  // implements first fit
+  int32_t* blockStart;
+  int32_t i;
   if(desiredWords <= 0){
     return 0; //NULL
   }
-  while(inHeapRange(blockStart)){
-  // one pass through the heap
-  // choose first block that is big enough
-    if(blockUnused(blockStart) && desiredWords <= blockRoom(blockStart)){
-      if(splitAndMarkBlockUsed(blockStart, desiredWords)){
-        return 0; //NULL
+  if(region < 0 || region >= heap->numRegions){
+    region = 0;
+  }
+  blockStart = firstFit(&heap->regions[region], desiredWords);
+  for(i = 0; blockStart == 0 && i < heap->numRegions; i++){
+    if(i != region){
+      blockStart = firstFit(&heap->regions[i], desiredWords);
+    }
+  }
+  if(blockStart == 0){
+    return 0; //NULL
+  }
+  if(splitAndMarkBlockUsed(blockStart, desiredWords)){
+    return 0; //NULL
+  }
+  return blockStart + 1;
+}
+
+
+//******** Heap_MallocBatch *************** 
+// Allocate several blocks of the same size, data not initialized
+// input: 
+//   desiredBytes: desired number of bytes in each block
+//   count: number of blocks wanted
+//   blocks: receives the blocks
+// output: number of blocks allocated; they are the first entries of
+//   blocks and the rest are set to NULL
+// notes: same placement as count calls to Heap_Malloc, but the heap is
+//   scanned once; each block is carved off the front of the free block
+//   that held the previous one
+int32_t Heap_MallocBatch(int32_t desiredBytes, int32_t count, void** blocks){
+  return Heap_MallocBatch_r(&defaultHeap, desiredBytes, count, blocks);
+}
+int32_t Heap_MallocBatch_r(heap_t* heap, int32_t desiredBytes, int32_t count, void** blocks){
+  int32_t desiredWords = (desiredBytes + sizeof(int32_t) - 1) / sizeof(int32_t);
+  int32_t done = 0;
+  int32_t r;
+  for(r = 0; r < heap->numRegions && done < count && desiredWords > 0; r++){
+    int32_t* blockStart = heap->regions[r].start;
+    while(blockStart < heap->regions[r].end && done < count){
+      BRANCH();
+      if(blockUnused(blockStart) && desiredWords <= blockRoom(blockStart)){
+        if(splitAndMarkBlockUsed(blockStart, desiredWords)){
+          break;
+        }
+        blocks[done] = blockStart + 1;
+        done++;
       }
-      return blockStart + 1;
+      blockStart = nextBlockHeader(blockStart); // leftover of a split, if any
+    }
+  }
+  for(r = done; r < count; r++){
+    blocks[r] = 0; //NULL
+  }
+  return done;
+}
+
+
+//******** Heap_Memalign *************** 
+// Allocate memory whose address is a multiple of alignment
+// input:
+//   alignment: power of 2 byte alignment for the returned pointer
+//   desiredBytes: desired number of bytes to allocate
+// output: void* pointing to the allocated memory or will return NULL
+//   if there isn't sufficient space or alignment isn't a power of 2
+// notes: the slack in front of the aligned block is split off as its
+//   own unused block, so it stays available to later allocations
+void* Heap_Memalign(int32_t alignment, int32_t desiredBytes){
+  return Heap_Memalign_r(&defaultHeap, alignment, desiredBytes);
+}
+void* Heap_Memalign_r(heap_t* heap, int32_t alignment, int32_t desiredBytes){
+  int32_t desiredWords = (desiredBytes + sizeof(int32_t) - 1) / sizeof(int32_t);
+  int32_t alignWords = alignment / sizeof(int32_t);
+  int32_t* blockStart;
+  int32_t r;
+  if(desiredWords <= 0 || alignment <= 0 || (alignment & (alignment - 1))){
+    return 0; //NULL
+  }
+  if(alignWords <= 1){
+    return Heap_Malloc_r(heap, desiredBytes); // every block is word aligned
+  }
+  for(r = 0; r < heap->numRegions; r++){
+    blockStart = heap->regions[r].start;  // implements first fit
+    while(blockStart < heap->regions[r].end){
+      BRANCH();
+      if(blockUnused(blockStart)){
+        // first aligned address for the data, and the words of slack before it
+        int32_t* data = (int32_t*)(((uintptr_t)(blockStart + 1) + alignment - 1) &
+                                   ~(uintptr_t)(alignment - 1));
+        int32_t leadRoom = data - (blockStart + 1);
+        // slack must be able to hold a header, a trailer and one word
+        while(leadRoom != 0 && leadRoom < 3){
+          data += alignWords;
+          leadRoom += alignWords;
+        }
+        if(leadRoom + desiredWords <= blockRoom(blockStart)){
+          if(leadRoom > 0){
+            int32_t room = blockRoom(blockStart);
+            int32_t* blockEnd = blockTrailer(blockStart);
+            STORE(blockStart, -(leadRoom - 2)); // slack, marked unused
+            STORE(blockStart + leadRoom - 1, -(leadRoom - 2));
+            blockStart += leadRoom;             // header just below data
+            STORE(blockStart, -(room - leadRoom));
+            STORE(blockEnd, -(room - leadRoom));
+          }
+          if(splitAndMarkBlockUsed(blockStart, desiredWords)){
+            return 0; //NULL
+          }
+          return blockStart + 1;
+        }
+      }
+      blockStart = nextBlockHeader(blockStart);
     }
-    blockStart = nextBlockHeader(blockStart);
   }
   return 0; //NULL
 }
@@ -106,21 +319,25 @@ void* Heap_Malloc(int32_t desiredBytes){
 // output: void* pointing to the allocated memory block or will return NULL
 //   if there isn't sufficient space to satisfy allocation request
 //notes: the allocated memory block will be zeroed out
-void* Heap_Calloc(int32_t num, int32_t size){  
+void* Heap_Calloc(int32_t num, int32_t size){
+  return Heap_Calloc_r(&defaultHeap, num, size);
+}
+void* Heap_Calloc_r(heap_t* heap, int32_t num, int32_t size){
   int32_t desiredBytes = num * size;
   int32_t* blockPtr;
   int32_t wordsToClear;
   int32_t i;
   
   //malloc a block
-  blockPtr = Heap_Malloc(desiredBytes);
+  blockPtr = Heap_Malloc_r(heap, desiredBytes);
   //did malloc fail?
   if(blockPtr == 0){
     return 0; //NULL
   }
-  wordsToClear = *(blockPtr - 1); //get room from header
+  wordsToClear = LOAD(blockPtr - 1); //get room from header
   //clear out block
   for(i = 0; i < wordsToClear; i++){
+    BRANCH();
     blockPtr[i] = 0;
   }
   return blockPtr;
@@ -136,8 +353,14 @@ void* Heap_Calloc(int32_t num, int32_t size){
 // output: void* pointing to the new block or will return NULL
 //   if there is any reason the reallocation can't be completed
 // notes: the given block will be unallocated after its contents
-//   are copied to the new block
+//   are copied to the new block; if the given block already has room
+//   for desiredBytes it is returned as is.  A moved block stays in the
+//   old block's region if that region has room.
 void* Heap_Realloc(void* oldBlock, int32_t desiredBytes){
+  return Heap_Realloc_r(&defaultHeap, oldBlock, desiredBytes);
+}
+void* Heap_Realloc_r(heap_t* heap, void* oldBlock, int32_t desiredBytes){
+  heap_region_t* region;
   int32_t* oldBlockPtr;
   int32_t* oldBlockStart;
   int32_t* newBlockPtr;
@@ -151,17 +374,24 @@ void* Heap_Realloc(void* oldBlock, int32_t desiredBytes){
   // 1) oldBlockPtr doesn't point in the heap
   // 2) oldBlockPtr points to an unused block
   oldBlockStart = oldBlockPtr - 1;
-  if(!inHeapRange(oldBlockStart) || blockUnused(oldBlockStart)){
+  region = regionOf(heap, oldBlockStart);
+  if(region == 0 || isSentinel(region, oldBlockStart) || blockUnused(oldBlockStart)){
     return 0; // NULL
   }
 
-  newBlockPtr = Heap_Malloc(desiredBytes);
+  // the old block already has the room, keep it
+  oldBlockRoom = blockRoom(oldBlockStart);
+  if(desiredBytes > 0 &&
+     (desiredBytes + sizeof(int32_t) - 1) / sizeof(int32_t) <= oldBlockRoom){
+    return oldBlock;
+  }
+
+  newBlockPtr = Heap_MallocRegion_r(heap, desiredBytes, region - heap->regions);
   // did Malloc fail?
   if(newBlockPtr == 0){
     return 0; // NULL
   }
   
-  oldBlockRoom = blockRoom(oldBlockStart);
   newBlockRoom = blockRoom(newBlockPtr - 1);
   if(oldBlockRoom < newBlockRoom){
     wordsToCopy = oldBlockRoom;
@@ -170,9 +400,10 @@ void* Heap_Realloc(void* oldBlock, int32_t desiredBytes){
     wordsToCopy = newBlockRoom;
   }  
   for(i = 0; i < wordsToCopy; i++){
+    BRANCH();
     newBlockPtr[i] = oldBlockPtr[i];
   }
-  if(Heap_Free(oldBlockPtr)){
+  if(Heap_Free_r(heap, oldBlockPtr)){
     return 0; // NULL Free failed
   }
   return newBlockPtr;
@@ -187,21 +418,49 @@ void* Heap_Realloc(void* oldBlock, int32_t desiredBytes){
 //  HEAP_ERROR_CORRUPTED_HEAP if heap has been corrupted or trying to
 //  unallocate memory that has already been unallocated;
 int32_t Heap_Free(void* pointer){
+  return Heap_Free_r(&defaultHeap, pointer);
+}
+int32_t Heap_Free_r(heap_t* heap, void* pointer){
+  return Heap_FreeSized_r(heap, pointer, 0);
+}
+
+
+//******** Heap_FreeSized *************** 
+// return a block of known size to the heap
+// input:
+//   pointer: pointer to memory to unallocate
+//   bytes: number of bytes asked for when the block was allocated,
+//     or 0 if unknown
+// output: HEAP_OK if everything is ok;
+//  HEAP_ERROR_POINTER_OUT_OF_RANGE if pointer points outside the heap;
+//  HEAP_ERROR_CORRUPTED_HEAP if heap has been corrupted, trying to
+//  unallocate memory that has already been unallocated, or the block
+//  has less room than bytes
+// notes: the size check catches a wrong pointer or a smashed header
+//  before anything is written
+int32_t Heap_FreeSized(void* pointer, int32_t bytes){
+  return Heap_FreeSized_r(&defaultHeap, pointer, bytes);
+}
+int32_t Heap_FreeSized_r(heap_t* heap, void* pointer, int32_t bytes){
+  int32_t desiredWords = (bytes + sizeof(int32_t) - 1) / sizeof(int32_t);
+  heap_region_t* region;
   int32_t* blockStart;
   int32_t* blockEnd;
+  int32_t* previousBlockStart;
   int32_t* nextBlockStart;
   
   blockStart = ((int32_t*)pointer) - 1;
 
   //-----Begin error checking-------
-  if(!inHeapRange(blockStart)){
+  region = regionOf(heap, blockStart);
+  if(region == 0 || isSentinel(region, blockStart)){
     return HEAP_ERROR_POINTER_OUT_OF_RANGE;
   }
-  if(blockUnused(blockStart)){
+  if(blockUnused(blockStart) || blockRoom(blockStart) < desiredWords){
     return HEAP_ERROR_CORRUPTED_HEAP;
   }
   blockEnd = blockTrailer(blockStart);
-  if(!inHeapRange(blockEnd) || blockUnused(blockEnd)){
+  if(!inRegion(region, blockEnd) || blockUnused(blockEnd)){
     return HEAP_ERROR_CORRUPTED_HEAP;
   }
   //-----End error checking-------
@@ -211,54 +470,153 @@ int32_t Heap_Free(void* pointer){
   }
 
   // time to possibly merge with block above
-  // first, make sure there IS a block above us
-  if(blockStart > HEAP_START){ 
-    int32_t* previousBlockStart = previousBlockHeader(blockStart);
-    // second, make sure we only merge with an unused block
-    if(blockUnused(previousBlockStart)){
-      mergeBlockWithBelow(previousBlockStart);
-      blockStart = previousBlockStart; // start of block has moved
-    }
+  // the region's start sentinel is always used, so there IS a block
+  // above us and the merge can't leave the region
+  previousBlockStart = previousBlockHeader(blockStart);
+  if(blockUnused(previousBlockStart)){
+    mergeBlockWithBelow(previousBlockStart);
+    blockStart = previousBlockStart; // start of block has moved
   }
 
-  // possibly merge with block below
+  // possibly merge with block below, likewise stopped by the end sentinel
   nextBlockStart = nextBlockHeader(blockStart);
-  if(inHeapRange(nextBlockStart) && blockUnused(nextBlockStart)){
+  if(blockUnused(nextBlockStart)){
     mergeBlockWithBelow(blockStart);
   }
   return HEAP_OK;
 }
 
 
+//******** Heap_FreeBatch *************** 
+// return several blocks to the heap
+// input:
+//   blocks: pointers to memory to unallocate, NULLs are skipped
+//   count: number of pointers
+// output: HEAP_OK if every block was freed, otherwise the error
+//  Heap_Free would give for the first bad pointer; bad pointers are
+//  skipped and set to NULL in blocks, and the rest are still freed
+// notes: blocks is sorted by address in place.  Runs of adjacent blocks
+//  are then merged with each other and their unused neighbours at once,
+//  writing one header and trailer per run instead of one per block.
+int32_t Heap_FreeBatch(void** blocks, int32_t count){
+  return Heap_FreeBatch_r(&defaultHeap, blocks, count);
+}
+int32_t Heap_FreeBatch_r(heap_t* heap, void** blocks, int32_t count){
+  int32_t result = HEAP_OK;
+  int32_t i = 0;
+  void* previous = 0;     // last pointer looked at, even if set to NULL
+
+  sortByAddress(blocks, count);
+  while(i < count){
+    BRANCH();
+    heap_region_t* region;
+    int32_t* runStart = ((int32_t*)blocks[i]) - 1;
+    int32_t* runEnd;
+    int32_t* previousBlockStart;
+    int32_t* nextBlockStart;
+
+    //-----Begin error checking-------
+    if(blocks[i] == 0){
+      i++;
+      continue;
+    }
+    // duplicates are next to each other once sorted
+    if(blocks[i] == previous){
+      if(result == HEAP_OK){
+        result = HEAP_ERROR_CORRUPTED_HEAP;
+      }
+      blocks[i] = 0;
+      i++;
+      continue;
+    }
+    previous = blocks[i];
+    region = regionOf(heap, runStart);
+    if(region == 0 || isSentinel(region, runStart)){
+      if(result == HEAP_OK){
+        result = HEAP_ERROR_POINTER_OUT_OF_RANGE;
+      }
+      blocks[i] = 0;
+      i++;
+      continue;
+    }
+    if(!blockFreeable(region, runStart)){
+      if(result == HEAP_OK){
+        result = HEAP_ERROR_CORRUPTED_HEAP;
+      }
+      blocks[i] = 0;
+      i++;
+      continue;
+    }
+    //-----End error checking-------
+
+    // grow the run while the next pointer is the very next block
+    runEnd = blockTrailer(runStart);
+    i++;
+    while(i < count && ((int32_t*)blocks[i]) - 1 == runEnd + 1 &&
+          blockFreeable(region, runEnd + 1)){
+      BRANCH();
+      previous = blocks[i];
+      runEnd = blockTrailer(runEnd + 1);
+      i++;
+    }
+
+    // the sentinels keep both neighbours inside the region
+    previousBlockStart = previousBlockHeader(runStart);
+    if(blockUnused(previousBlockStart)){
+      runStart = previousBlockStart;
+    }
+    nextBlockStart = runEnd + 1;
+    if(blockUnused(nextBlockStart)){
+      runEnd = blockTrailer(nextBlockStart);
+    }
+    STORE(runStart, -(runEnd - runStart - 1)); // marked unused
+    STORE(runEnd, -(runEnd - runStart - 1));
+  }
+  return result;
+}
+
+
 //******** Heap_Test *************** 
 // Test the heap
 // input: none
 // output: validity of the heap - either HEAP_OK or HEAP_ERROR_HEAP_CORRUPTED
 int32_t Heap_Test(void){
-  int32_t lastBlockWasUnused = 0;
-  int32_t* blockStart = HEAP_START;
-  while(inHeapRange(blockStart)){
-    int32_t* blockEnd;
-    
-    //shouldn't have any blocks holding zero words
-    if(*blockStart == 0){
+  return Heap_Test_r(&defaultHeap);
+}
+int32_t Heap_Test_r(heap_t* heap){
+  int32_t r;
+  for(r = 0; r < heap->numRegions; r++){
+    heap_region_t* region = &heap->regions[r];
+    int32_t lastBlockWasUnused = 0;
+    int32_t* blockStart = region->start;
+    //both sentinels must still be used one word blocks
+    if(LOAD(region->start) != 1 || LOAD(region->start + 2) != 1 ||
+       LOAD(region->end - SENTINEL_WORDS) != 1 || LOAD(region->end - 1) != 1){
       return HEAP_ERROR_CORRUPTED_HEAP;
     }
-    blockEnd = blockTrailer(blockStart);
-    //error if blockEnd is not in the heap or blockend disagrees with blockStart
-    if(!inHeapRange(blockEnd) || *blockStart != *blockEnd){
-      return HEAP_ERROR_CORRUPTED_HEAP;
+    while(inRegion(region, blockStart)){
+      int32_t* blockEnd;
+      
+      //shouldn't have any blocks holding zero words
+      if(LOAD(blockStart) == 0){
+        return HEAP_ERROR_CORRUPTED_HEAP;
+      }
+      blockEnd = blockTrailer(blockStart);
+      //error if blockEnd is not in the region or blockend disagrees with blockStart
+      if(!inRegion(region, blockEnd) || LOAD(blockStart) != LOAD(blockEnd)){
+        return HEAP_ERROR_CORRUPTED_HEAP;
+      }
+      //error if we have two adjacent unused blocks
+      if(lastBlockWasUnused && blockUnused(blockStart)){
+        return HEAP_ERROR_CORRUPTED_HEAP;
+      }
+      lastBlockWasUnused = blockUnused(blockStart);
+      blockStart = blockEnd + 1;
     }
-    //error if we have two adjacent unused blocks
-    if(lastBlockWasUnused && blockUnused(blockStart)){
+    //traversing the region should end exactly where the region ends
+    if(blockStart != region->end){
       return HEAP_ERROR_CORRUPTED_HEAP;
     }
-    lastBlockWasUnused = blockUnused(blockStart);
-    blockStart = blockEnd + 1;
-  }
-  //traversing the heap should end exactly where the heap ends
-  if(blockStart != HEAP_END){
-    return HEAP_ERROR_CORRUPTED_HEAP;
   }
   return HEAP_OK;
 }
@@ -268,46 +626,268 @@ int32_t Heap_Test(void){
 // return the current status of the heap
 // input: none
 // output: a heap_stats_t that describes the current usage of the heap
+// notes: sentinel blocks count as overhead, not as used blocks
 heap_stats_t Heap_Stats(void){
+  return Heap_Stats_r(&defaultHeap);
+}
+heap_stats_t Heap_Stats_r(heap_t* heap){
   int32_t* blockStart;
+  int32_t heapWords = 0;
+  int32_t r;
   heap_stats_t stats;
   
   stats.wordsAllocated = 0;
   stats.wordsAvailable = 0;
   stats.blocksUsed = 0;
   stats.blocksUnused = 0;
+  stats.wordsLargestFree = 0;
 
   //just go through each block to get stats on heap usage
-  blockStart = HEAP_START;
-  while(inHeapRange(blockStart)){
-    if(blockUsed(blockStart)){
-      stats.wordsAllocated += blockRoom(blockStart);
-      stats.blocksUsed++;
-    }
-    else{
-      stats.wordsAvailable += blockRoom(blockStart);
-      stats.blocksUnused++;
+  for(r = 0; r < heap->numRegions; r++){
+    heapWords += heap->regions[r].end - heap->regions[r].start;
+    blockStart = heap->regions[r].start + SENTINEL_WORDS;
+    while(blockStart < heap->regions[r].end - SENTINEL_WORDS){
+      if(blockUsed(blockStart)){
+        stats.wordsAllocated += blockRoom(blockStart);
+        stats.blocksUsed++;
+      }
+      else{
+        stats.wordsAvailable += blockRoom(blockStart);
+        stats.blocksUnused++;
+        if(blockRoom(blockStart) > stats.wordsLargestFree){
+          stats.wordsLargestFree = blockRoom(blockStart);
+        }
+      }
+      blockStart = nextBlockHeader(blockStart);
     }
-    blockStart = nextBlockHeader(blockStart);
   }
-  stats.wordsOverhead = HEAP_SIZE_WORDS - stats.wordsAllocated - stats.wordsAvailable;
+  stats.wordsOverhead = heapWords - stats.wordsAllocated - stats.wordsAvailable;
   return stats;
 }
 
 
-// inHeapRange
+//******** Heap_Walk *************** 
+// Visit every block of the heap
+// input:
+//   walker: function called with each block
+//   ctx: passed through to walker
+// output: HEAP_OK, or HEAP_ERROR_CORRUPTED_HEAP if the walk fell off the
+//   heap; blocks up to the corruption have been visited
+// notes: regions are walked in order; sentinel blocks are skipped
+int32_t Heap_Walk(heap_walker_t walker, void* ctx){
+  return Heap_Walk_r(&defaultHeap, walker, ctx);
+}
+int32_t Heap_Walk_r(heap_t* heap, heap_walker_t walker, void* ctx){
+  int32_t r;
+  for(r = 0; r < heap->numRegions; r++){
+    heap_region_t* region = &heap->regions[r];
+    int32_t* blockStart = region->start + SENTINEL_WORDS;
+    while(blockStart < region->end - SENTINEL_WORDS){
+      int32_t* blockEnd = blockTrailer(blockStart);
+      if(LOAD(blockStart) == 0 || !inRegion(region, blockEnd)){
+        return HEAP_ERROR_CORRUPTED_HEAP;
+      }
+      walker(blockStart + 1, blockRoom(blockStart) * sizeof(int32_t), blockUsed(blockStart), ctx);
+      blockStart = blockEnd + 1;
+    }
+  }
+  return HEAP_OK;
+}
+
+
+//******** Heap_Size *************** 
+// Usable size of an allocated block
+// input: pointer returned by Heap_Malloc/Calloc/Realloc
+// output: number of bytes the block can hold, or 0 if the pointer
+//   isn't an allocated block in the heap
+int32_t Heap_Size(void* pointer){
+  return Heap_Size_r(&defaultHeap, pointer);
+}
+int32_t Heap_Size_r(heap_t* heap, void* pointer){
+  int32_t* blockStart = ((int32_t*)pointer) - 1;
+  heap_region_t* region = regionOf(heap, blockStart);
+  if(region == 0 || isSentinel(region, blockStart) || !blockUsed(blockStart)){
+    return 0;
+  }
+  return blockRoom(blockStart) * sizeof(int32_t);
+}
+
+
+#ifdef HEAP_COUNT_ACCESSES
+//******** Heap_AccessReset *************** 
+// Start counting metadata accesses from zero
+// input: none
+// output: none
+void Heap_AccessReset(void){
+  accesses.loads = 0;
+  accesses.stores = 0;
+  accesses.lines = 0;
+  accesses.branches = 0;
+}
+
+
+//******** Heap_Accesses *************** 
+// Metadata accesses since Heap_AccessReset
+// input: none
+// output: loads, stores, distinct lines touched and loop branches
+heap_access_t Heap_Accesses(void){
+  return accesses;
+}
+
+
+// countAccess
+// input: address of a metadata word, and whether it is written
+// output: none
+static void countAccess(int32_t* address, int32_t store){
+  uintptr_t line = (uintptr_t)address / ACCESS_LINE_BYTES;
+  int32_t i;
+  if(store){
+    accesses.stores++;
+  }
+  else{
+    accesses.loads++;
+  }
+  for(i = 0; i < accesses.lines && i < ACCESS_MAX_LINES; i++){
+    if(linesSeen[i] == line){
+      return;
+    }
+  }
+  if(accesses.lines < ACCESS_MAX_LINES){
+    linesSeen[accesses.lines] = line;
+  }
+  accesses.lines++;
+}
+#endif
+
+
+// alignRegion
+// input:
+//   region: filled in with the word aligned bounds of the memory
+//   base, bytes: the memory
+// output: HEAP_OK, or HEAP_ERROR_BAD_REGION if the memory can't hold
+//   both sentinels and one useful block
+static int32_t alignRegion(heap_region_t* region, void* base, int32_t bytes){
+  region->start = (int32_t*)(((uintptr_t)base + sizeof(int32_t) - 1) & ~(uintptr_t)(sizeof(int32_t) - 1));
+  region->end = (int32_t*)(((uintptr_t)base + bytes) & ~(uintptr_t)(sizeof(int32_t) - 1));
+  if(bytes <= 0 || region->end - region->start < 2 * SENTINEL_WORDS + 3){
+    return HEAP_ERROR_BAD_REGION;
+  }
+  return HEAP_OK;
+}
+
+
+// formatRegion
+// input: a region from alignRegion
+// output: none
+// notes: lays out the start sentinel, one unused block with all the
+//   remaining room, and the end sentinel
+static void formatRegion(heap_region_t* region){
+  int32_t* start = region->start;
+  int32_t* end = region->end;
+  int32_t room = (end - start) - 2 * SENTINEL_WORDS - 2;
+  STORE(start, 1); // one word of room, marked used
+  STORE(start + 1, 0);
+  STORE(start + 2, 1);
+  STORE(start + SENTINEL_WORDS, -room);
+  STORE(end - SENTINEL_WORDS - 1, -room);
+  STORE(end - 3, 1);
+  STORE(end - 2, 0);
+  STORE(end - 1, 1);
+}
+
+
+// regionOf
 // input: a pointer
-// output: whether or not the pointer points inside the heap
-static int32_t inHeapRange(int32_t* address){
-  return address >= HEAP_START && address < HEAP_END;
+// output: the region the pointer points into, or 0 if it is outside the heap
+static heap_region_t* regionOf(heap_t* heap, int32_t* address){
+  int32_t r;
+  for(r = 0; r < heap->numRegions; r++){
+    BRANCH();
+    if(inRegion(&heap->regions[r], address)){
+      return &heap->regions[r];
+    }
+  }
+  return 0;
 }
 
 
+// blockFreeable
+// input: a region and the header of a block in it
+// output: whether or not the block is an allocated block that
+//   Heap_Free would accept
+static int32_t blockFreeable(heap_region_t* region, int32_t* blockStart){
+  int32_t* blockEnd;
+  if(isSentinel(region, blockStart) || blockUnused(blockStart)){
+    return 0;
+  }
+  blockEnd = blockTrailer(blockStart);
+  return inRegion(region, blockEnd) && LOAD(blockEnd) == LOAD(blockStart);
+}
+
+
+// sortByAddress
+// input: pointers and how many there are
+// output: none
+// notes: Shell sort, ascending; in place so a batch needs no scratch memory
+static void sortByAddress(void** blocks, int32_t count){
+  int32_t gap;
+  int32_t i, j;
+  for(gap = count / 2; gap > 0; gap = (gap == 2) ? 1 : gap * 5 / 11){
+    for(i = gap; i < count; i++){
+      void* block = blocks[i];
+      for(j = i; j >= gap && (uintptr_t)blocks[j - gap] > (uintptr_t)block; j -= gap){
+        BRANCH();
+        blocks[j] = blocks[j - gap];
+      }
+      blocks[j] = block;
+    }
+  }
+}
+
+
+// inRegion
+// input: a region and a pointer
+// output: whether or not the pointer points inside the region
+static int32_t inRegion(heap_region_t* region, int32_t* address){
+  return address >= region->start && address < region->end;
+}
+
+
+// isSentinel
+// input: a region and the header of one of its blocks
+// output: whether or not the block is one of the region's sentinels
+static int32_t isSentinel(heap_region_t* region, int32_t* blockStart){
+  return blockStart == region->start || blockStart == region->end - SENTINEL_WORDS;
+}
+
+
+// firstFit
+// input:
+//   region: region to search
+//   desiredWords: room needed
+// output: header of the first unused block in the region with enough
+//   room, or 0 if there is none
+static int32_t* firstFit(heap_region_t* region, int32_t desiredWords){
+  int32_t* blockStart = region->start;
+  while(blockStart < region->end){
+    BRANCH();
+  // one pass through the region
+  // choose first block that is big enough
+    if(blockUnused(blockStart) && desiredWords <= blockRoom(blockStart)){
+      return blockStart;
+    }
+    blockStart = nextBlockHeader(blockStart);
+  }
+  return 0;
+}
+
+
+
 // blockUsed
 // input: pointer to the header or trailer of a block
 // output: whether or not the block is marked as used/allocated
 static int32_t blockUsed(int32_t* block){
-  return *block > 0;
+  return LOAD(block) > 0;
 }
 
 
@@ -315,7 +895,7 @@ static int32_t blockUsed(int32_t* block){
 // input: pointer to the header or trailer of a block
 // output: whether or not the block is marked as unused/unallocated
 static int32_t blockUnused(int32_t* block){
-  return *block < 0;
+  return LOAD(block) < 0;
 }
 
 
@@ -323,10 +903,11 @@ static int32_t blockUnused(int32_t* block){
 // input: pointer to the header or trailer of a block
 // output: how many words of data the block can hold
 static int32_t blockRoom(int32_t* block){
-  if(*block > 0){
-    return *block;
+  int32_t room = LOAD(block);
+  if(room > 0){
+    return room;
   }
-  return -*block;
+  return -room;
 }
 
 
@@ -360,8 +941,8 @@ static int32_t* blockTrailer(int32_t* blockStart){
 // nextBlockHeader
 // input: pointer to the header of a block
 // output: pointer the the header of the next block in the heap
-// notes: given the header of the last block in the heap, will point to HEAP_END,
-//   which is not a valid block; be careful
+// notes: given the header of a region's end sentinel, will point to the end
+//   of the region, which is not a valid block; be careful
 static int32_t* nextBlockHeader(int32_t* blockStart){
   return blockTrailer(blockStart) + 1;
 }
@@ -370,7 +951,7 @@ static int32_t* nextBlockHeader(int32_t* blockStart){
 // previousBlockHeader
 // input: pointer to the header of a block
 // output: pointer the the header of the previous block in the heap
-// notes: given the header of the first block in the heap, this function
+// notes: given the header of a region's start sentinel, this function
 //   will go crazy and return a proportionally crazy address!
 static int32_t* previousBlockHeader(int32_t* blockStart){
   return blockHeader(blockStart - 1);
@@ -384,11 +965,12 @@ static int32_t* previousBlockHeader(int32_t* blockStart){
 //notes: marks the block as used/allocated
 static int32_t markBlockUsed(int32_t* blockStart){
   int32_t* blockEnd = blockTrailer(blockStart);
-  if(blockUsed(blockStart) || *blockStart != *blockEnd){
+  int32_t room = LOAD(blockStart);
+  if(room > 0 || room != LOAD(blockEnd)){
     return HEAP_ERROR_CORRUPTED_HEAP;
   }
-  *blockStart = -*blockStart;
-  *blockEnd = -*blockEnd;
+  STORE(blockStart, -room);
+  STORE(blockEnd, -room);
   return HEAP_OK;
 }
 
@@ -400,11 +982,12 @@ static int32_t markBlockUsed(int32_t* blockStart){
 // notes: marks the block as unused/unallocated
 static int32_t markBlockUnused(int32_t* blockStart){
   int32_t* blockEnd = blockTrailer(blockStart);
-  if(blockUnused(blockStart) || *blockStart != *blockEnd){
+  int32_t room = LOAD(blockStart);
+  if(room < 0 || room != LOAD(blockEnd)){
     return HEAP_ERROR_CORRUPTED_HEAP;
   }
-  *blockStart = -*blockStart;
-  *blockEnd = -*blockEnd;
+  STORE(blockStart, -room);
+  STORE(blockEnd, -room);
   return HEAP_OK;
 }
 
@@ -425,10 +1008,10 @@ static int32_t splitAndMarkBlockUsed(int32_t* upperBlockStart, int32_t desiredRo
     int32_t* upperBlockEnd = upperBlockStart + desiredRoom + 1;
     int32_t* lowerBlockStart = upperBlockEnd + 1;
     int32_t* lowerBlockEnd = blockTrailer(upperBlockStart);
-    *upperBlockStart = desiredRoom; // marked used
-    *upperBlockEnd = desiredRoom;
-    *lowerBlockStart = -leftoverRoom; // marked unused
-    *lowerBlockEnd = -leftoverRoom;
+    STORE(upperBlockStart, desiredRoom); // marked used
+    STORE(upperBlockEnd, desiredRoom);
+    STORE(lowerBlockStart, -leftoverRoom); // marked unused
+    STORE(lowerBlockEnd, -leftoverRoom);
   }
   // can't split block - just mark it at used
   else{
@@ -451,8 +1034,8 @@ static void mergeBlockWithBelow(int32_t* upperBlockStart){
   int32_t* lowerBlockEnd = blockTrailer(lowerBlockStart);
 
   int32_t room = lowerBlockEnd - upperBlockStart - 1;
-  *upperBlockStart = -room;
-  *lowerBlockEnd = -room;
+  STORE(upperBlockStart, -room);
+  STORE(lowerBlockEnd, -room);
   return;
 }
 
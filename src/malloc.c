@@ -1,21 +1,55 @@
 #include <stdint.h>
 #include <stddef.h>
+#include <errno.h>
+#include <string.h>
 #include "SysTick.h"
 #include "knuth.h"
 #include "heap.h"
 #include "malloc.h"
+#include "cost_model.h"
 
 uint8_t heap_mem[MALLOC_SIZE];
 
+// the ARM C library's errno.h only has the math errors
+#ifndef EINVAL
+#define EINVAL 22
+#endif
+#ifndef ENOMEM
+#define ENOMEM 12
+#endif
+
+// every op gets the allocator state of the heap it works on
 typedef struct _heap_ops
 {
-    void (* init) (void);
-    void * (* malloc) (size_t size);
-    void * (* calloc) (size_t nmemb, size_t size);
-    void * (* realloc) (void * ptr, size_t size);
-    void (* free) (void * ptr);
-} heap_ops;
+    int (* init) (void * self, void * base, size_t size);   // 0 if ok
+    void * (* malloc) (void * self, size_t size);
+    void * (* calloc) (void * self, size_t nmemb, size_t size);
+    void * (* realloc) (void * self, void * ptr, size_t size);
+    void (* free) (void * self, void * ptr);
+    // optional, NULL if the allocator can't use the caller's size
+    void (* free_sized) (void * self, void * ptr, size_t size);
+    // optional, NULL if the allocator has no aligned allocation
+    void * (* memalign) (void * self, size_t alignment, size_t size);
+    // optional, NULL if the allocator manages a single region
+    int (* add_region) (void * self, void * base, size_t size);     // 0 if ok
+    void * (* malloc_region) (void * self, size_t size, int region);
+    // optional, NULL to fall back to a loop of single calls
+    size_t (* malloc_batch) (void * self, size_t size, size_t n, void ** out);
+    void (* free_batch) (void * self, void ** ptrs, size_t n);
+
+    // optional, only set when the allocator is built to count its
+    // metadata accesses; counts are for calls since access_reset
+    // and are shared by all heaps
+    void (* access_reset) (void);
+    heap_access (* accesses) (void);
 
+    // optional introspection, NULL if the allocator can't provide it
+    int (* walk) (void * self, heap_walker walker, void * ctx);     // 0 if ok
+    int (* validate) (void * self);                                 // 0 if ok
+    size_t (* usable_size) (void * self, void * ptr);
+    size_t (* largest_free) (void * self);
+    size_t (* metadata_bytes) (void * self);
+} heap_ops;
 
 
 typedef struct _allocator
@@ -23,36 +57,38 @@ typedef struct _allocator
     const char * name;
     const char * desc;
     const heap_ops * ops;
-    heap_stats stats;
 } allocator;
 
 // Knuth shims
-struct knuth knuth;
-void shim_knuth_init(void)
+int shim_knuth_init(void * self, void * base, size_t size)
 {
-    knuth_init(&knuth, heap_mem, MALLOC_SIZE, 2);
+    knuth_init((struct knuth *) self, base, size, 2);
+    return 0;
 }
 
-void * shim_knuth_malloc(size_t size)
+void * shim_knuth_malloc(void * self, size_t size)
 {
-    return knuth_malloc(&knuth, size);
+    return knuth_malloc((struct knuth *) self, size);
 }
 
-void * shim_knuth_calloc(size_t nmemb, size_t size)
+void * shim_knuth_calloc(void * self, size_t nmemb, size_t size)
 {
-    return knuth_calloc(&knuth, nmemb, size);
+    return knuth_calloc((struct knuth *) self, nmemb, size);
 }
 
-void * shim_knuth_realloc(void * ptr, size_t size)
+void * shim_knuth_realloc(void * self, void * ptr, size_t size)
 {
-    return knuth_realloc(&knuth, ptr, size);
+    return knuth_realloc((struct knuth *) self, ptr, size);
 }
 
-void shim_knuth_free(void * ptr)
+void shim_knuth_free(void * self, void * ptr)
 {
-    knuth_free(&knuth, ptr);
+    knuth_free((struct knuth *) self, ptr);
 }
 
+// knuth.h doesn't expose the block layout, so no introspection or aligned
+// ops: walk and validate report MALLOC_UNSUPPORTED, usable size is 0,
+// aligned_alloc fails and malloc_largest_free() falls back to probing
 const heap_ops knuth_ops =
 {
     .init = shim_knuth_init,
@@ -61,7 +97,7 @@ const heap_ops knuth_ops =
     .calloc = shim_knuth_calloc,
     .free = shim_knuth_free
 };
-allocator knuth_allocator =
+const allocator knuth_allocator =
 {
     .name = "Brandon's Knuth",
     .desc = "Knuth heap with embedded free list",
@@ -70,26 +106,134 @@ allocator knuth_allocator =
 //
 
 // valvano
-void shim_val_init(void)
+int shim_val_init(void * self, void * base, size_t size)
+{
+    return Heap_InitRegion_r((heap_t *) self, base, size);
+}
+
+void * shim_val_malloc(void * self, size_t size)
+{
+    return Heap_Malloc_r((heap_t *) self, size);
+}
+
+void * shim_val_calloc(void * self, size_t nmemb, size_t size)
+{
+    return Heap_Calloc_r((heap_t *) self, nmemb, size);
+}
+
+void * shim_val_realloc(void * self, void * ptr, size_t size)
+{
+    return Heap_Realloc_r((heap_t *) self, ptr, size);
+}
+
+void shim_val_free(void * self, void * ptr)
+{
+    Heap_Free_r((heap_t *) self, ptr);
+}
+
+void shim_val_free_sized(void * self, void * ptr, size_t size)
+{
+    Heap_FreeSized_r((heap_t *) self, ptr, size);
+}
+
+void * shim_val_memalign(void * self, size_t alignment, size_t size)
+{
+    return Heap_Memalign_r((heap_t *) self, alignment, size);
+}
+
+int shim_val_add_region(void * self, void * base, size_t size)
+{
+    return Heap_AddRegion_r((heap_t *) self, base, size);
+}
+
+void * shim_val_malloc_region(void * self, size_t size, int region)
+{
+    return Heap_MallocRegion_r((heap_t *) self, size, region);
+}
+
+size_t shim_val_malloc_batch(void * self, size_t size, size_t n, void ** out)
+{
+    return Heap_MallocBatch_r((heap_t *) self, size, n, out);
+}
+
+void shim_val_free_batch(void * self, void ** ptrs, size_t n)
+{
+    Heap_FreeBatch_r((heap_t *) self, ptrs, n);
+}
+
+typedef struct _val_walk_ctx
+{
+    heap_walker walker;
+    void * ctx;
+} val_walk_ctx;
+
+static
+void shim_val_walker(void * data, int32_t bytes, int32_t used, void * ctx)
+{
+    val_walk_ctx * w = (val_walk_ctx *) ctx;
+    w->walker(data, bytes, used, w->ctx);
+}
+
+int shim_val_walk(void * self, heap_walker walker, void * ctx)
+{
+    val_walk_ctx w = {walker, ctx};
+    return Heap_Walk_r((heap_t *) self, shim_val_walker, &w);
+}
+
+int shim_val_validate(void * self)
+{
+    return Heap_Test_r((heap_t *) self);
+}
+
+size_t shim_val_usable_size(void * self, void * ptr)
+{
+    return Heap_Size_r((heap_t *) self, ptr);
+}
+
+size_t shim_val_largest_free(void * self)
+{
+    return Heap_Stats_r((heap_t *) self).wordsLargestFree * sizeof(int32_t);
+}
+
+size_t shim_val_metadata_bytes(void * self)
 {
-    Heap_Init();
+    return Heap_Stats_r((heap_t *) self).wordsOverhead * sizeof(int32_t);
 }
 
-void shim_val_free(void * ptr)
+#ifdef HEAP_COUNT_ACCESSES
+heap_access shim_val_accesses(void)
 {
-    Heap_Free(ptr);
+    heap_access_t counts = Heap_Accesses();
+    heap_access a = {counts.loads, counts.stores, counts.lines, counts.branches};
+    return a;
 }
+#endif
 
 const heap_ops val_ops =
 {
     .init = shim_val_init,
-    .malloc = Heap_Malloc,
-    .realloc = Heap_Realloc,
-    .calloc = Heap_Calloc,
-    .free = shim_val_free
+    .malloc = shim_val_malloc,
+    .realloc = shim_val_realloc,
+    .calloc = shim_val_calloc,
+    .free = shim_val_free,
+    .free_sized = shim_val_free_sized,
+    .memalign = shim_val_memalign,
+    .add_region = shim_val_add_region,
+    .malloc_region = shim_val_malloc_region,
+    .malloc_batch = shim_val_malloc_batch,
+    .free_batch = shim_val_free_batch,
+#ifdef HEAP_COUNT_ACCESSES
+    .access_reset = Heap_AccessReset,
+    .accesses = shim_val_accesses,
+#endif
+    .walk = shim_val_walk,
+    .validate = shim_val_validate,
+    .usable_size = shim_val_usable_size,
+    .largest_free = shim_val_largest_free,
+    .metadata_bytes = shim_val_metadata_bytes
 };
 
-allocator val_allocator =
+const allocator val_allocator =
 {
     .name = "Valvano",
     .desc = "Valvanoware heap.c, Knuth heap",
@@ -97,26 +241,78 @@ allocator val_allocator =
 };
 //
 
+// one allocator instance; nothing in here is shared with other heaps
+struct _heap_instance
+{
+    const allocator * alloc;
+    heap_impl impl;
+    heap_stats stats;
+    // where the heap lives; regions past the first come from
+    // malloc_add_region and survive resets
+    uint8_t * region_base[MALLOC_MAX_REGIONS];
+    size_t region_size[MALLOC_MAX_REGIONS];
+    int num_regions;
+    int in_use;
+    // blocks freed by other heaps' callers or from interrupts, linked
+    // through their first word; only ever pushed onto or taken whole
+    void * volatile remote;
+    // the allocator's own state, passed to every op
+    union
+    {
+        heap_t val;
+        struct knuth knuth;
+    } state;
+};
+
+// heaps[0] is the default heap behind malloc() and the other calls
+// without a heap argument, all of heap_mem unless malloc_init_region
+// says otherwise; the rest are handed out by heap_create
+static heap_instance heaps[MALLOC_MAX_HEAPS] =
+{
+    {.region_base = {heap_mem}, .region_size = {MALLOC_SIZE}, .num_regions = 1, .in_use = 1}
+};
+#define DEFAULT_HEAP (&heaps[0])
+// heaps from heap_create in use; with none, every block is the default heap's
+static int num_created = 0;
+
+// ISR pool: fixed size blocks on a lock-free free list, reserved out of
+// the default heap so interrupts never touch a heap itself
+static uint8_t * pool_mem = NULL;
+static size_t pool_block = 0;
+static size_t pool_bytes = 0;       // 0 while there's no pool
+static void * volatile pool_free = NULL;
+static volatile uint32_t pool_allocs = 0;
+static volatile uint32_t pool_fails = 0;
+
 void stat_init(heap_stat * stat)
 {
     stat->sn = 0;
     stat->fn = 0;
     stat->st = 0;
     stat->ft = 0;
+    stat->loads = 0;
+    stat->stores = 0;
+    stat->lines = 0;
+    stat->branches = 0;
 }
 
-void allocator_init(allocator * a)
+void stats_init(heap_stats * stats)
 {
-    stat_init(&a->stats.malloc);
-    stat_init(&a->stats.realloc);
-    stat_init(&a->stats.calloc);
-    stat_init(&a->stats.free);
+    stat_init(&stats->malloc);
+    stat_init(&stats->realloc);
+    stat_init(&stats->calloc);
+    stat_init(&stats->free);
+    stat_init(&stats->memalign);
 }
 
-static allocator * alloc = NULL;
-static heap_impl curr_impl;
-void malloc_init(heap_impl impl)
+// (re)initializes impl in the heap's regions; an allocator that can't
+// take the extra regions drops them. If the first region is unusable the
+// heap is left as it was: knuth_init can't tell, so the size is checked
+// here and Valvano's init doesn't touch its state when it fails.
+static
+int heap_setup(heap_instance * h, heap_impl impl)
 {
+    const allocator * alloc = &val_allocator;
     switch(impl)
     {
     case IMPL_VALVANO:
@@ -126,9 +322,411 @@ void malloc_init(heap_impl impl)
         alloc = &knuth_allocator;
         break;
     }
-    allocator_init (alloc);
-    alloc->ops->init();
-    curr_impl = impl;
+    const heap_ops * ops = alloc->ops;
+    if (h->region_size[0] < MALLOC_MIN_REGION ||
+        ops->init(&h->state, h->region_base[0], h->region_size[0]) != 0)
+        return 1;
+    h->alloc = alloc;
+    h->impl = impl;
+    h->remote = NULL;
+    stats_init(&h->stats);
+    int added = 1;
+    for (int i = 1; i < h->num_regions && ops->add_region != NULL; ++i) {
+        if (ops->add_region(&h->state, h->region_base[i], h->region_size[i]) != 0)
+            break;
+        ++added;
+    }
+    h->num_regions = added;
+    return 0;
+}
+
+// heap_create'd heaps usually live in memory malloc'd from the default
+// heap; once that is reinitialized they would claim its new blocks in
+// heap_owner, so any overlapping one is destroyed with it
+static
+void drop_created(void)
+{
+    heap_instance * d = DEFAULT_HEAP;
+    for (int i = 1; i < MALLOC_MAX_HEAPS && num_created > 0; ++i) {
+        heap_instance * h = &heaps[i];
+        if (!h->in_use)
+            continue;
+        int overlaps = 0;
+        for (int r = 0; r < h->num_regions && !overlaps; ++r) {
+            for (int dr = 0; dr < d->num_regions; ++dr) {
+                if (h->region_base[r] < d->region_base[dr] + d->region_size[dr] &&
+                    d->region_base[dr] < h->region_base[r] + h->region_size[r])
+                    overlaps = 1;
+            }
+        }
+        if (overlaps) {
+            h->in_use = 0;
+            --num_created;
+        }
+    }
+}
+
+// the ISR pool's memory goes with the old heap
+static
+void pool_drop(void)
+{
+    pool_bytes = 0;
+    pool_block = 0;
+    pool_free = NULL;
+    pool_mem = NULL;
+}
+
+int malloc_init_region(heap_impl impl, void * base, size_t size)
+{
+    heap_instance * h = DEFAULT_HEAP;
+    uint8_t * old_base = h->region_base[0];
+    size_t old_size = h->region_size[0];
+    int old_regions = h->num_regions;
+
+    h->region_base[0] = (uint8_t *) base;
+    h->region_size[0] = size;
+    h->num_regions = 1;
+    if (heap_setup(h, impl) != 0) {
+        h->region_base[0] = old_base;
+        h->region_size[0] = old_size;
+        h->num_regions = old_regions;
+        return 1;
+    }
+    pool_drop();
+    drop_created();
+    return 0;
+}
+
+int malloc_add_region(void * base, size_t size)
+{
+    heap_instance * h = DEFAULT_HEAP;
+    const heap_ops * ops = h->alloc->ops;
+    if (ops->add_region == NULL)
+        return MALLOC_UNSUPPORTED;
+    if (h->num_regions == MALLOC_MAX_REGIONS || ops->add_region(&h->state, base, size) != 0)
+        return 1;
+    h->region_base[h->num_regions] = (uint8_t *) base;
+    h->region_size[h->num_regions] = size;
+    ++h->num_regions;
+    return 0;
+}
+
+void malloc_init(heap_impl impl)
+{
+    pool_drop();
+    heap_setup(DEFAULT_HEAP, impl);
+    drop_created();
+}
+
+heap_instance * heap_create(heap_impl impl, void * base, size_t size)
+{
+    for (int i = 1; i < MALLOC_MAX_HEAPS; ++i) {
+        heap_instance * h = &heaps[i];
+        if (h->in_use)
+            continue;
+        h->region_base[0] = (uint8_t *) base;
+        h->region_size[0] = size;
+        h->num_regions = 1;
+        if (heap_setup(h, impl) != 0)
+            return NULL;
+        h->in_use = 1;
+        ++num_created;
+        return h;
+    }
+    return NULL;
+}
+
+void heap_destroy(heap_instance * heap)
+{
+    if (heap != NULL && heap != DEFAULT_HEAP && heap->in_use) {
+        heap->in_use = 0;
+        --num_created;
+    }
+}
+
+heap_instance * heap_default(void)
+{
+    return DEFAULT_HEAP;
+}
+
+// the heap a block came from, or h if no heap holds it so h's allocator
+// reports the bad pointer; heap_create'd heaps may sit inside the default
+// heap's memory, so they are looked at first
+static
+heap_instance * heap_owner(heap_instance * h, void * ptr)
+{
+    if (num_created == 0)
+        return h;
+    for (int i = MALLOC_MAX_HEAPS - 1; i >= 0; --i) {
+        heap_instance * owner = &heaps[i];
+        if (!owner->in_use)
+            continue;
+        for (int r = 0; r < owner->num_regions; ++r) {
+            uint8_t * base = owner->region_base[r];
+            if ((uint8_t *) ptr >= base && (uint8_t *) ptr < base + owner->region_size[r])
+                return owner;
+        }
+    }
+    return h;
+}
+
+// nonzero in an exception handler, where IPSR holds the exception number
+#if defined(__CC_ARM)
+static inline
+uint32_t in_isr(void)
+{
+    register uint32_t ipsr __asm("ipsr");
+    return ipsr;
+}
+#elif defined(__arm__)
+static inline
+uint32_t in_isr(void)
+{
+    uint32_t ipsr;
+    __asm volatile ("mrs %0, ipsr" : "=r" (ipsr));
+    return ipsr;
+}
+#else
+#define in_isr() 0
+#endif
+
+// Lock-free lists linked through the first word of each block: the
+// remote-free lists and the ISR pool. On the M4 a failed STREX means
+// another context wrote the head, or an exception was taken (exception
+// entry and return clear the exclusive monitor), between the LDREX and
+// the STREX, and the loop just tries again.
+// A remote-free list has any number of pushers and its heap takes the
+// whole list at once, so there is no ABA problem.
+#if defined(__CC_ARM)
+static inline
+void list_push(void * volatile * head, void * ptr)
+{
+    do {
+        *(void **) ptr = (void *) __ldrex(head);
+    } while (__strex((uint32_t) ptr, head) != 0);
+}
+
+static inline
+void * list_take(void * volatile * head)
+{
+    void * list;
+    do {
+        list = (void *) __ldrex(head);
+    } while (__strex(0, head) != 0);
+    return list;
+}
+
+// the pool has poppers in any context; reading the next link between the
+// LDREX and the STREX is safe because anything that could reuse the block
+// in between also breaks the reservation
+static inline
+void * list_pop(void * volatile * head)
+{
+    void * ptr;
+    do {
+        ptr = (void *) __ldrex(head);
+        if (ptr == NULL) {
+            __clrex();
+            return NULL;
+        }
+    } while (__strex((uint32_t) *(void **) ptr, head) != 0);
+    return ptr;
+}
+
+static inline
+void count_up(volatile uint32_t * count)
+{
+    do {
+    } while (__strex(__ldrex(count) + 1, count) != 0);
+}
+#else
+// startup.s
+long StartCritical(void);
+void EndCritical(long sr);
+
+static inline
+void list_push(void * volatile * head, void * ptr)
+{
+    void * next;
+    do {
+        next = *head;
+        *(void **) ptr = next;
+    } while (!__sync_bool_compare_and_swap(head, next, ptr));
+}
+
+static inline
+void * list_take(void * volatile * head)
+{
+    return __sync_lock_test_and_set(head, NULL);
+}
+
+// a compare and swap pop could suffer ABA, so the splice alone is a
+// critical section of a few instructions
+static inline
+void * list_pop(void * volatile * head)
+{
+    long sr = StartCritical();
+    void * ptr = *head;
+    if (ptr != NULL)
+        *head = *(void **) ptr;
+    EndCritical(sr);
+    return ptr;
+}
+
+static inline
+void count_up(volatile uint32_t * count)
+{
+    __sync_fetch_and_add(count, 1);
+}
+#endif
+
+#define remote_push(h, ptr) list_push(&(h)->remote, (ptr))
+#define remote_take(h) list_take(&(h)->remote)
+
+static inline
+int in_pool(void * ptr)
+{
+    return (size_t) ((uint8_t *) ptr - pool_mem) < pool_bytes;
+}
+
+// the only allocation there is from an interrupt
+static
+void * isr_malloc(size_t size)
+{
+    void * ptr = (size <= pool_block) ? list_pop(&pool_free) : NULL;
+    count_up((ptr != NULL) ? &pool_allocs : &pool_fails);
+    return ptr;
+}
+
+int malloc_isr_pool(size_t block_size, size_t count)
+{
+    heap_instance * h = DEFAULT_HEAP;
+    const heap_ops * ops = h->alloc->ops;
+
+    // interrupts see no pool from here on
+    pool_block = 0;
+    pool_free = NULL;
+    pool_bytes = 0;
+    if (pool_mem != NULL)
+        ops->free(&h->state, pool_mem);
+    pool_mem = NULL;
+    pool_allocs = 0;
+    pool_fails = 0;
+    if (block_size == 0 || count == 0)
+        return 0;
+
+    // whole words, so every block's free list link is aligned
+    block_size = (block_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    // untimed, the pool isn't a benchmark allocation
+    pool_mem = ops->malloc(&h->state, block_size * count);
+    if (pool_mem == NULL)
+        return 1;
+    for (size_t i = count; i > 0; --i) {
+        list_push(&pool_free, pool_mem + (i - 1) * block_size);
+    }
+    pool_bytes = block_size * count;
+    pool_block = block_size;
+    return 0;
+}
+
+isr_pool_stats malloc_isr_pool_stats(void)
+{
+    isr_pool_stats stats;
+    stats.block_size = pool_block;
+    stats.blocks = (pool_block > 0) ? pool_bytes / pool_block : 0;
+    stats.allocs = pool_allocs;
+    stats.fails = pool_fails;
+    return stats;
+}
+
+// cycles taken by the most recent call, for benchmarks that track latency
+static uint32_t last_cycles = 0;
+
+// call site recording: totals per return address in an open addressing
+// table, linear probing; sites that don't fit are only counted
+#if defined(__CC_ARM)
+#define CALLER() ((uintptr_t) __return_address())
+#else
+#define CALLER() ((uintptr_t) __builtin_return_address(0))
+#endif
+
+static int recording = 0;
+static callsite sites[MALLOC_CALLSITES];
+static uint32_t sites_dropped = 0;
+
+// metadata access counts of the most recent call
+static heap_access last_access = {0, 0, 0, 0};
+
+static inline
+void access_begin(const heap_ops * ops)
+{
+    if (ops->access_reset != NULL)
+        ops->access_reset();
+}
+
+static inline
+void access_end(const heap_ops * ops, heap_stat * stat)
+{
+    if (ops->accesses == NULL)
+        return;
+    last_access = ops->accesses();
+    stat->loads += last_access.loads;
+    stat->stores += last_access.stores;
+    stat->lines += last_access.lines;
+    stat->branches += last_access.branches;
+}
+
+static
+void record(uintptr_t addr, char op, uint32_t count, size_t bytes, uint32_t cycles)
+{
+    // an empty batch took no slot's worth of calls
+    if (count == 0)
+        return;
+    // Fibonacci hash, the top bits of the product are the well mixed ones;
+    // Thumb return addresses always have bit 0 set
+    uint32_t i = ((uint32_t) (addr >> 1) * 2654435761u) >> (32 - MALLOC_CALLSITES_BITS);
+    for (uint32_t probes = 0; probes < MALLOC_CALLSITES; ++probes) {
+        callsite * site = &sites[i];
+        if (site->addr == addr || site->addr == 0) {
+            site->addr = addr;
+            site->op = op;
+            site->count += count;
+            site->bytes += bytes;
+            site->cycles += cycles;
+            return;
+        }
+        i = (i + 1) & (MALLOC_CALLSITES - 1);
+    }
+    sites_dropped += count;
+}
+
+void malloc_record(int on)
+{
+    recording = on;
+}
+
+void malloc_record_clear(void)
+{
+    memset(sites, 0, sizeof(sites));
+    sites_dropped = 0;
+}
+
+int malloc_callsites(callsite * out, int max, uint32_t * dropped)
+{
+    int n = 0;
+    for (int i = 0; i < MALLOC_CALLSITES && n < max; ++i) {
+        if (sites[i].addr == 0)
+            continue;
+        // insertion sort, most cycles first
+        int j = n++;
+        for (; j > 0 && out[j - 1].cycles < sites[i].cycles; --j) {
+            out[j] = out[j - 1];
+        }
+        out[j] = sites[i];
+    }
+    if (dropped != NULL)
+        *dropped = sites_dropped;
+    return n;
 }
 
 static inline
@@ -152,107 +750,672 @@ uint32_t diff_timer(uint32_t start, uint32_t end)
     return start - end;
 }
 
+// Frees the blocks on h's remote list a chunk at a time, through the batch
+// op when there is one. The cycles go to h's free time but not its free
+// count, which the free that pushed each block already took.
+#define DRAIN_CHUNK 16
+
+static
+void drain_remote(heap_instance * h)
+{
+    if (h->remote == NULL)
+        return;
+    const heap_ops * ops = h->alloc->ops;
+    void * list = remote_take(h);
+    while (list != NULL) {
+        void * chunk[DRAIN_CHUNK];
+        size_t n = 0;
+        for (; n < DRAIN_CHUNK && list != NULL; ++n) {
+            chunk[n] = list;
+            list = *(void **) list;
+        }
+        access_begin(ops);
+        uint32_t start = start_timer();
+        if (ops->free_batch != NULL) {
+            ops->free_batch(&h->state, chunk, n);
+        } else {
+            for (size_t i = 0; i < n; ++i) {
+                ops->free(&h->state, chunk[i]);
+            }
+        }
+        uint32_t end = stop_timer();
+        access_end(ops, &h->stats.free);
+        h->stats.free.st += diff_timer(start, end);
+    }
+}
+
+// the timed calls below take the caller's return address as the call site,
+// so both the plain and the heap_ entry points record where they were called
+
+static
+void * timed_malloc(heap_instance * h, size_t size, uintptr_t site)
+{
+    if (in_isr())
+        return isr_malloc(size);
+    drain_remote(h);
+    uint32_t start = 0;
+    uint32_t end = 0;
+    const heap_ops * ops = h->alloc->ops;
+    access_begin(ops);
+    start = start_timer();
+    void * ptr = ops->malloc(&h->state, size);
+    end = stop_timer();
+    
+    last_cycles = diff_timer(start, end);
+    access_end(ops, &h->stats.malloc);
+    if (recording)
+        record(site, 'm', 1, size, last_cycles);
+    if (ptr != NULL) {
+        h->stats.malloc.st += diff_timer(start, end);
+        h->stats.malloc.sn += 1;
+    } else {
+        h->stats.malloc.ft += diff_timer(start, end);
+        h->stats.malloc.fn += 1;
+    }
+
+    return ptr;
+}
+
 void * malloc(size_t size)
 {
+    return timed_malloc(DEFAULT_HEAP, size, CALLER());
+}
+
+void * heap_malloc(heap_instance * heap, size_t size)
+{
+    return timed_malloc(heap, size, CALLER());
+}
+
+void * malloc_region(size_t size, int region)
+{
+    uintptr_t site = CALLER();
     uint32_t start = 0;
     uint32_t end = 0;
-    void * (* f) (size_t) = alloc->ops->malloc;
+    heap_instance * h = DEFAULT_HEAP;
+    const heap_ops * ops = h->alloc->ops;
+    if (ops->malloc_region == NULL || in_isr())
+        return timed_malloc(h, size, site);
+    drain_remote(h);
+    access_begin(ops);
     start = start_timer();
-    void * ptr = f(size);
+    void * ptr = ops->malloc_region(&h->state, size, region);
     end = stop_timer();
     
+    last_cycles = diff_timer(start, end);
+    access_end(ops, &h->stats.malloc);
+    if (recording)
+        record(site, 'm', 1, size, last_cycles);
     if (ptr != NULL) {
-        alloc->stats.malloc.st += diff_timer(start, end);
-        alloc->stats.malloc.sn += 1;
+        h->stats.malloc.st += diff_timer(start, end);
+        h->stats.malloc.sn += 1;
     } else {
-        alloc->stats.malloc.ft += diff_timer(start, end);
-        alloc->stats.malloc.fn += 1;
+        h->stats.malloc.ft += diff_timer(start, end);
+        h->stats.malloc.fn += 1;
     }
 
     return ptr;
 }
 
+static
+void * timed_calloc(heap_instance * h, size_t nmemb, size_t size, uintptr_t site)
+{
+    if (in_isr()) {
+        void * ptr = isr_malloc(nmemb * size);
+        if (ptr != NULL)
+            memset(ptr, 0, nmemb * size);
+        return ptr;
+    }
+    drain_remote(h);
+    uint32_t start = 0;
+    uint32_t end = 0;
+    const heap_ops * ops = h->alloc->ops;
+    access_begin(ops);
+    start = start_timer();
+    void * ptr = ops->calloc(&h->state, nmemb, size);
+    end = stop_timer();
+    
+    last_cycles = diff_timer(start, end);
+    access_end(ops, &h->stats.calloc);
+    if (recording)
+        record(site, 'c', 1, nmemb * size, last_cycles);
+    if (ptr != NULL) {
+        h->stats.calloc.st += diff_timer(start, end);
+        h->stats.calloc.sn += 1;
+    } else {
+        h->stats.calloc.ft += diff_timer(start, end);
+        h->stats.calloc.fn += 1;
+    }
+    return ptr;
+}
+
 void * calloc(size_t nmemb, size_t size)
 {
+    return timed_calloc(DEFAULT_HEAP, nmemb, size, CALLER());
+}
+
+void * heap_calloc(heap_instance * heap, size_t nmemb, size_t size)
+{
+    return timed_calloc(heap, nmemb, size, CALLER());
+}
+
+static
+void * timed_realloc(heap_instance * h, void * ptr, size_t size, uintptr_t site)
+{
+    if (in_isr()) {
+        // from an interrupt nothing can move; a pool block grows within itself
+        if (ptr == NULL)
+            return isr_malloc(size);
+        return (in_pool(ptr) && size <= pool_block) ? ptr : NULL;
+    }
+    if (in_pool(ptr)) {
+        // a pool block that outgrows the block moves to the heap
+        if (size <= pool_block)
+            return ptr;
+        void * moved = timed_malloc(h, size, site);
+        if (moved != NULL) {
+            memcpy(moved, ptr, pool_block);
+            list_push(&pool_free, ptr);
+        }
+        return moved;
+    }
+    // another heap's block moves to h and goes back to its owner like a
+    // free would. Only its header is read: the owner's allocator never runs
+    // here, so without a usable size to copy the realloc fails.
+    heap_instance * owner = heap_owner(h, ptr);
+    if (owner != h) {
+        const heap_ops * owner_ops = owner->alloc->ops;
+        if (owner_ops->usable_size == NULL)
+            return NULL;
+        size_t old = owner_ops->usable_size(&owner->state, ptr);
+        void * moved = timed_malloc(h, size, site);
+        if (moved != NULL) {
+            memcpy(moved, ptr, (old < size) ? old : size);
+            remote_push(owner, ptr);
+        }
+        return moved;
+    }
+    drain_remote(h);
     uint32_t start = 0;
     uint32_t end = 0;
-    void * (* f) (size_t, size_t) = alloc->ops->calloc;
+    const heap_ops * ops = h->alloc->ops;
+    access_begin(ops);
     start = start_timer();
-    void * ptr = f(nmemb, size);
+    // already big enough: nothing to move
+    if (ptr == NULL || size == 0 || ops->usable_size == NULL || size > ops->usable_size(&h->state, ptr))
+        ptr = ops->realloc(&h->state, ptr, size);
     end = stop_timer();
     
+    last_cycles = diff_timer(start, end);
+    access_end(ops, &h->stats.realloc);
+    if (recording)
+        record(site, 'r', 1, size, last_cycles);
     if (ptr != NULL) {
-        alloc->stats.calloc.st += diff_timer(start, end);
-        alloc->stats.calloc.sn += 1;
+        h->stats.realloc.st += diff_timer(start, end);
+        h->stats.realloc.sn += 1;
     } else {
-        alloc->stats.calloc.ft += diff_timer(start, end);
-        alloc->stats.calloc.fn += 1;
+        h->stats.realloc.ft += diff_timer(start, end);
+        h->stats.realloc.fn += 1;
     }
     return ptr;
 }
 
 void * realloc(void * ptr, size_t size)
 {
+    return timed_realloc(DEFAULT_HEAP, ptr, size, CALLER());
+}
+
+void * heap_realloc(heap_instance * heap, void * ptr, size_t size)
+{
+    return timed_realloc(heap, ptr, size, CALLER());
+}
+
+static
+void * timed_aligned_alloc(heap_instance * h, size_t alignment, size_t size, uintptr_t site)
+{
+    if (in_isr())
+        return NULL;
+    drain_remote(h);
     uint32_t start = 0;
     uint32_t end = 0;
-    void * (* f) (void *, size_t) = alloc->ops->realloc;
+    const heap_ops * ops = h->alloc->ops;
+    // no native support: fail every time rather than whenever the
+    // natural placement happens to be misaligned
+    if (ops->memalign == NULL)
+        return NULL;
+    void * ptr;
+    access_begin(ops);
     start = start_timer();
-    ptr = f(ptr, size);
+    ptr = ops->memalign(&h->state, alignment, size);
     end = stop_timer();
-    
+
+    last_cycles = diff_timer(start, end);
+    access_end(ops, &h->stats.memalign);
+    if (recording)
+        record(site, 'a', 1, size, last_cycles);
     if (ptr != NULL) {
-        alloc->stats.realloc.st += diff_timer(start, end);
-        alloc->stats.realloc.sn += 1;
+        h->stats.memalign.st += diff_timer(start, end);
+        h->stats.memalign.sn += 1;
     } else {
-        alloc->stats.realloc.ft += diff_timer(start, end);
-        alloc->stats.realloc.fn += 1;
+        h->stats.memalign.ft += diff_timer(start, end);
+        h->stats.memalign.fn += 1;
     }
     return ptr;
 }
 
+void * aligned_alloc(size_t alignment, size_t size)
+{
+    return timed_aligned_alloc(DEFAULT_HEAP, alignment, size, CALLER());
+}
+
+void * heap_aligned_alloc(heap_instance * heap, size_t alignment, size_t size)
+{
+    return timed_aligned_alloc(heap, alignment, size, CALLER());
+}
+
+int posix_memalign(void ** memptr, size_t alignment, size_t size)
+{
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+    if (!malloc_has_aligned_alloc())
+        return EINVAL;
+
+    void * ptr = timed_aligned_alloc(DEFAULT_HEAP, alignment, size, CALLER());
+    if (ptr == NULL)
+        return ENOMEM;
+    *memptr = ptr;
+    return 0;
+}
+
+// a pool block goes back on the pool and another heap's block onto its
+// owner's remote list; 0 if the block is h's to free
+static
+int route_free(heap_instance * h, void * ptr)
+{
+    if (in_pool(ptr)) {
+        list_push(&pool_free, ptr);
+        return 1;
+    }
+    heap_instance * owner = heap_owner(h, ptr);
+    if (owner == h)
+        return 0;
+    remote_push(owner, ptr);
+    return 1;
+}
+
+// From an interrupt only the lock-free pushes are done: the heap, its stats
+// and SysTick may all be in the middle of a call from the interrupted task.
+// The owner frees a heap block at its next allocating call.
+static
+int isr_free(heap_instance * h, void * ptr)
+{
+    if (!in_isr())
+        return 0;
+    if (ptr != NULL && !route_free(h, ptr))
+        remote_push(h, ptr);
+    return 1;
+}
+
+static
+void timed_free(heap_instance * h, void * ptr, uintptr_t site)
+{
+    uint32_t start = 0;
+    uint32_t end = 0;
+    const heap_ops * ops = h->alloc->ops;
+    if (isr_free(h, ptr))
+        return;
+    access_begin(ops);
+    start = start_timer();
+    if (!route_free(h, ptr))
+        ops->free(&h->state, ptr);
+    end = stop_timer();
+    
+    last_cycles = diff_timer(start, end);
+    access_end(ops, &h->stats.free);
+    if (recording)
+        record(site, 'f', 1, 0, last_cycles);
+    h->stats.free.st += diff_timer(start, end);
+    h->stats.free.sn += 1;
+}
+
 void free(void * ptr)
 {
+    timed_free(DEFAULT_HEAP, ptr, CALLER());
+}
+
+void heap_free(heap_instance * heap, void * ptr)
+{
+    timed_free(heap, ptr, CALLER());
+}
+
+// one timed call for the whole batch; stats count each element
+size_t malloc_batch(size_t size, size_t n, void ** out)
+{
+    uintptr_t site = CALLER();
     uint32_t start = 0;
     uint32_t end = 0;
-    void (* f) (void *) = alloc->ops->free;
+    heap_instance * h = DEFAULT_HEAP;
+    const heap_ops * ops = h->alloc->ops;
+    size_t got = 0;
+    if (in_isr()) {
+        memset(out, 0, n * sizeof(void *));
+        return 0;
+    }
+    drain_remote(h);
+    access_begin(ops);
     start = start_timer();
-    f(ptr);
+    if (ops->malloc_batch != NULL) {
+        got = ops->malloc_batch(&h->state, size, n, out);
+    } else {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = ops->malloc(&h->state, size);
+            if (out[i] != NULL)
+                ++got;
+        }
+    }
+    end = stop_timer();
+
+    last_cycles = diff_timer(start, end);
+    access_end(ops, &h->stats.malloc);
+    if (recording)
+        record(site, 'm', n, size * got, last_cycles);
+    if (got > 0) {
+        h->stats.malloc.st += diff_timer(start, end);
+    } else {
+        h->stats.malloc.ft += diff_timer(start, end);
+    }
+    h->stats.malloc.sn += got;
+    h->stats.malloc.fn += n - got;
+    return got;
+}
+
+void free_batch(void ** ptrs, size_t n)
+{
+    uintptr_t site = CALLER();
+    uint32_t start = 0;
+    uint32_t end = 0;
+    heap_instance * h = DEFAULT_HEAP;
+    const heap_ops * ops = h->alloc->ops;
+    if (in_isr()) {
+        for (size_t i = 0; i < n; ++i) {
+            isr_free(h, ptrs[i]);
+        }
+        return;
+    }
+    access_begin(ops);
+    start = start_timer();
+    // pool blocks and other heaps' blocks are pushed like a single free
+    // would and moved past the end of the default heap's own blocks
+    size_t own = n;
+    for (size_t i = 0; i < own; ) {
+        if (ptrs[i] != NULL && route_free(h, ptrs[i])) {
+            void * routed = ptrs[i];
+            ptrs[i] = ptrs[--own];
+            ptrs[own] = routed;
+        } else {
+            ++i;
+        }
+    }
+    if (ops->free_batch != NULL) {
+        ops->free_batch(&h->state, ptrs, own);
+    } else {
+        for (size_t i = 0; i < own; ++i) {
+            ops->free(&h->state, ptrs[i]);
+        }
+    }
+    end = stop_timer();
+
+    // the native op NULLs what it couldn't free, so whatever is left was freed
+    uint32_t freed = n - own;
+    for (size_t i = 0; i < own; ++i) {
+        if (ptrs[i] != NULL)
+            ++freed;
+    }
+    last_cycles = diff_timer(start, end);
+    access_end(ops, &h->stats.free);
+    if (recording)
+        record(site, 'f', freed, 0, last_cycles);
+    h->stats.free.st += diff_timer(start, end);
+    h->stats.free.sn += freed;
+}
+
+void free_sized(void * ptr, size_t size)
+{
+    uintptr_t site = CALLER();
+    uint32_t start = 0;
+    uint32_t end = 0;
+    heap_instance * h = DEFAULT_HEAP;
+    const heap_ops * ops = h->alloc->ops;
+    if (isr_free(h, ptr))
+        return;
+    access_begin(ops);
+    start = start_timer();
+    if (!route_free(h, ptr)) {
+        if (ops->free_sized != NULL)
+            ops->free_sized(&h->state, ptr, size);
+        else
+            ops->free(&h->state, ptr);
+    }
     end = stop_timer();
     
-    alloc->stats.free.st += diff_timer(start, end);
-    alloc->stats.free.sn += 1;
+    last_cycles = diff_timer(start, end);
+    access_end(ops, &h->stats.free);
+    if (recording)
+        record(site, 'f', 1, 0, last_cycles);
+    h->stats.free.st += diff_timer(start, end);
+    h->stats.free.sn += 1;
+}
+
+size_t malloc_usable_size(void * ptr)
+{
+    heap_instance * h = DEFAULT_HEAP;
+    if (in_pool(ptr))
+        return pool_block;
+    if (ptr == NULL || h->alloc->ops->usable_size == NULL)
+        return 0;
+    return h->alloc->ops->usable_size(&h->state, ptr);
+}
+
+int heap_walk(heap_instance * heap, heap_walker walker, void * ctx)
+{
+    if (heap->alloc->ops->walk == NULL)
+        return MALLOC_UNSUPPORTED;
+    return heap->alloc->ops->walk(&heap->state, walker, ctx);
+}
+
+int malloc_walk(heap_walker walker, void * ctx)
+{
+    return heap_walk(DEFAULT_HEAP, walker, ctx);
+}
+
+int heap_validate(heap_instance * heap)
+{
+    if (heap->alloc->ops->validate == NULL)
+        return MALLOC_UNSUPPORTED;
+    return heap->alloc->ops->validate(&heap->state);
+}
+
+int malloc_validate(void)
+{
+    return heap_validate(DEFAULT_HEAP);
+}
+
+static
+void sum_blocks(void * ptr, size_t size, int used, void * ctx)
+{
+    *(size_t *) ctx += size;
+}
+
+// everything in the heap that isn't usable block memory
+// 0 if the allocator can neither report it nor be walked
+size_t malloc_metadata_bytes(void)
+{
+    heap_instance * h = DEFAULT_HEAP;
+    if (h->alloc->ops->metadata_bytes != NULL)
+        return h->alloc->ops->metadata_bytes(&h->state);
+
+    size_t blocks = 0;
+    if (malloc_walk(sum_blocks, &blocks) != 0)
+        return 0;
+    return malloc_heap_size() - blocks;
+}
+
+heap_stats heap_get_stats(heap_instance * heap)
+{
+    return heap->stats;
 }
 
 heap_stats malloc_stats(void)
 {
-    return alloc->stats;
+    return DEFAULT_HEAP->stats;
+}
+
+heap_impl malloc_current_impl(void)
+{
+    return DEFAULT_HEAP->impl;
+}
+
+size_t heap_size(heap_instance * heap)
+{
+    size_t total = 0;
+    for (int i = 0; i < heap->num_regions; ++i) {
+        total += heap->region_size[i];
+    }
+    return total;
+}
+
+size_t malloc_heap_size(void)
+{
+    return heap_size(DEFAULT_HEAP);
+}
+
+void * malloc_heap_base(void)
+{
+    return DEFAULT_HEAP->region_base[0];
+}
+
+int malloc_num_regions(void)
+{
+    return DEFAULT_HEAP->num_regions;
+}
+
+void * malloc_region_base(int region)
+{
+    heap_instance * h = DEFAULT_HEAP;
+    return (region >= 0 && region < h->num_regions) ? h->region_base[region] : NULL;
+}
+
+size_t malloc_region_size(int region)
+{
+    heap_instance * h = DEFAULT_HEAP;
+    return (region >= 0 && region < h->num_regions) ? h->region_size[region] : 0;
+}
+
+uint32_t malloc_last_cycles(void)
+{
+    return last_cycles;
+}
+
+heap_access malloc_last_accesses(void)
+{
+    return last_access;
+}
+
+int malloc_counts_accesses(void)
+{
+    return DEFAULT_HEAP->alloc->ops->accesses != NULL;
+}
+
+int malloc_has_aligned_alloc(void)
+{
+    return DEFAULT_HEAP->alloc->ops->memalign != NULL;
+}
+
+int malloc_has_usable_size(void)
+{
+    return DEFAULT_HEAP->alloc->ops->usable_size != NULL;
+}
+
+// largest single allocation that would currently succeed
+// without a native op this probes the allocator directly, so stats are untouched
+size_t heap_largest_free(heap_instance * heap)
+{
+    const heap_ops * ops = heap->alloc->ops;
+    if (ops->largest_free != NULL)
+        return ops->largest_free(&heap->state);
+
+    size_t lo = 0;
+    size_t hi = heap_size(heap);
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo + 1) / 2;
+        void * ptr = ops->malloc(&heap->state, mid);
+        if (ptr != NULL) {
+            ops->free(&heap->state, ptr);
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+size_t malloc_largest_free(void)
+{
+    return heap_largest_free(DEFAULT_HEAP);
 }
 
 void malloc_print_stats(void)
 {
-    printf("Allocator: %s\n", alloc->name);
-    heap_stats_print(&alloc->stats);
+    printf("Allocator: %s\n", DEFAULT_HEAP->alloc->name);
+    heap_stats_print(&DEFAULT_HEAP->stats);
+}
+
+// 0 when nothing was counted; a 64 bit divide by zero traps under ARMCC
+static
+uint32_t avg(uint64_t total, uint32_t count)
+{
+    return (count > 0) ? (uint32_t) (total / count) : 0;
 }
 
 void heap_stats_print(const heap_stats * stats)
 {
-    printf("Successful %d mallocs, %d frees, %d callocs, %d reallocs\n",
-           stats->malloc.sn, stats->free.sn, stats->calloc.sn, stats->realloc.sn);
-    printf("Failed %d mallocs, %d frees, %d callocs, %d reallocs\n",
-           stats->malloc.fn, stats->free.fn, stats->calloc.fn, stats->realloc.fn);
+    printf("Successful %d mallocs, %d frees, %d callocs, %d reallocs, %d aligned\n",
+           stats->malloc.sn, stats->free.sn, stats->calloc.sn, stats->realloc.sn, stats->memalign.sn);
+    printf("Failed %d mallocs, %d frees, %d callocs, %d reallocs, %d aligned\n",
+           stats->malloc.fn, stats->free.fn, stats->calloc.fn, stats->realloc.fn, stats->memalign.fn);
     puts("");
-    printf("Avg. successful malloc time: %d cycles\n", stats->malloc.st / stats->malloc.sn);
-    printf("Avg. successful free time: %d cycles\n", stats->free.st / stats->free.sn);
-    printf("Avg. successful calloc time: %d cycles\n", stats->calloc.st / stats->calloc.sn);
-    printf("Avg. successful realloc time: %d cycles\n", stats->realloc.st / stats->realloc.sn);
+    printf("Avg. successful malloc time: %d cycles\n", avg(stats->malloc.st, stats->malloc.sn));
+    printf("Avg. successful free time: %d cycles\n", avg(stats->free.st, stats->free.sn));
+    printf("Avg. successful calloc time: %d cycles\n", avg(stats->calloc.st, stats->calloc.sn));
+    printf("Avg. successful realloc time: %d cycles\n", avg(stats->realloc.st, stats->realloc.sn));
+    printf("Avg. successful aligned alloc time: %d cycles\n", avg(stats->memalign.st, stats->memalign.sn));
     puts("");
-    printf("Avg. failed malloc time: %d cycles\n", stats->malloc.ft / stats->malloc.fn);
-    printf("Avg. failed free time: %d cycles\n", stats->free.ft / stats->free.fn);
-    printf("Avg. failed calloc time: %d cycles\n", stats->calloc.ft / stats->calloc.fn);
-    printf("Avg. failed realloc time: %d cycles\n", stats->realloc.ft / stats->realloc.fn);
+    printf("Avg. failed malloc time: %d cycles\n", avg(stats->malloc.ft, stats->malloc.fn));
+    printf("Avg. failed free time: %d cycles\n", avg(stats->free.ft, stats->free.fn));
+    printf("Avg. failed calloc time: %d cycles\n", avg(stats->calloc.ft, stats->calloc.fn));
+    printf("Avg. failed realloc time: %d cycles\n", avg(stats->realloc.ft, stats->realloc.fn));
+    printf("Avg. failed aligned alloc time: %d cycles\n", avg(stats->memalign.ft, stats->memalign.fn));
+
+    // only an allocator built to count accesses has any
+    const heap_stat * stat[] = {&stats->malloc, &stats->free, &stats->calloc, &stats->realloc, &stats->memalign};
+    const char * names[] = {"malloc", "free", "calloc", "realloc", "aligned alloc"};
+    if (stats->malloc.loads + stats->free.loads == 0)
+        return;
+    puts("");
+    puts("(measured cycles include the counting itself; compare the model with a normal build)");
+    for (int i = 0; i < sizeof(stat) / sizeof(stat[0]); ++i) {
+        uint32_t calls = stat[i]->sn + stat[i]->fn;
+        if (calls == 0)
+            continue;
+        printf("Avg. %s metadata accesses: %d loads, %d stores, %d lines, %d branches\n", names[i],
+               (uint32_t) (stat[i]->loads / calls), (uint32_t) (stat[i]->stores / calls),
+               (uint32_t) (stat[i]->lines / calls), (uint32_t) (stat[i]->branches / calls));
+        printf("    M4 model: %d cycles, measured %d cycles\n",
+               (uint32_t) (cost_estimate(&cost_model, stat[i]) / calls),
+               (uint32_t) ((stat[i]->st + stat[i]->ft) / calls));
+    }
 }
 
 void malloc_reset(void)
 {
-    malloc_init(curr_impl);
+    malloc_init(DEFAULT_HEAP->impl);
 }
\ No newline at end of file
@@ -14,6 +14,13 @@ int cmd_set_impl(int argc, char ** argv);
 int cmd_stats(int argc, char ** argv);
 int cmd_reset(int argc, char ** argv);
 int cmd_benchmark(int argc, char ** argv);
+int cmd_binary(int argc, char ** argv);
+int cmd_heap_info(int argc, char ** argv);
+int cmd_heap_size(int argc, char ** argv);
+int cmd_heap_region(int argc, char ** argv);
+int cmd_callsites(int argc, char ** argv);
+int cmd_heap_map(int argc, char ** argv);
+int cmd_cost(int argc, char ** argv);
 
 // shell stuff
 
@@ -27,7 +34,14 @@ const command cmds[] =
     {"set-impl", "<implementation>", "Sets the allocator implementation. Will reset heap and stats.", cmd_set_impl},
     {"stats", "", "Print name and stats of current implementation since last set", cmd_stats},
     {"reset", "", "Reinitializes the heap of the current implementation", cmd_reset},
+    {"heap-size", "[bytes] [offset]", "Places the heap in part of heap_mem. Will reset heap and stats.", cmd_heap_size},
+    {"heap-region", "[bytes offset]", "Lists heap regions, or adds part of heap_mem as another region.", cmd_heap_region},
+    {"heap-info", "", "Checks the heap and prints block, overhead and fragmentation figures", cmd_heap_info},
+    {"heapmap", "[bytes per cell (def 64)] [color]", "Draws heap_mem as a grid of used, free and metadata cells", cmd_heap_map},
+    {"cost", "[parameter value]", "Shows or tunes the Cortex-M4 cycle model used with counted accesses", cmd_cost},
+    {"callsites", "[on|off|clear|top N (def 10)]", "Records allocator calls per call site, or prints the costliest sites", cmd_callsites},
     {"bench", "<benchmark name>", "Runs a benchmark. Resets the heap before hand.", cmd_benchmark},
+    {"binary", "", "Switches to the framed binary protocol for host tools", cmd_binary},
 };
 
 int cmd_stats(int argc, char ** argv)